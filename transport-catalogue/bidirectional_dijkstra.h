@@ -0,0 +1,217 @@
+#pragma once
+
+#include "graph.h"
+#include "router_base.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Point-to-point queries searched from both ends at once: forward from the source,
+    // backward over the incoming edges from the target, until the searches meet.
+    // Given a lower bound of route weights, both searches are goal-directed (A*) with the
+    // averaged potential (lower_bound(v, to) - lower_bound(from, v)) / 2, which keeps
+    // the usual stopping rule valid. Search state is kept only for the vertices reached.
+    template <typename Weight>
+    class BidirectionalDijkstraRouter : public RouterBase<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+        using EdgeWeigher = std::function<Weight(const Edge<Weight>&)>;
+        // Must obey the triangle inequality; it's scaled down until no edge is cheaper than
+        // the bound between its ends, so an optimistic-enough estimate will do
+        using LowerBound = std::function<Weight(VertexId, VertexId)>;
+
+        // Without a lower bound it's a plain bidirectional Dijkstra; without a weigher the
+        // weights stored in the graph are used
+        explicit BidirectionalDijkstraRouter(const Graph& graph, LowerBound lower_bound = {}, const EdgeWeigher& edge_weigher = {});
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+
+        struct Label {
+            Weight weight;
+            Weight potential;
+            EdgeId prev_edge;
+        };
+
+        struct Search {
+            using QueueItem = std::tuple<Weight, Weight, VertexId>;
+
+            std::unordered_map<VertexId, Label> labels;
+            // Key (weight + potential), weight, vertex
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+            Weight GetTopKey() const {
+                return queue.empty() ? INFINITE_WEIGHT : std::get<0>(queue.top());
+            }
+        };
+
+        Weight GetEdgeWeight(EdgeId edge_id) const;
+        // Forward potential of a vertex, the backward one is its negation
+        Weight GetPotential(VertexId vertex, VertexId from, VertexId to) const;
+
+        const Graph& graph_;
+        // Empty unless the router was given its own weigher
+        std::vector<Weight> edge_weights_;
+        LowerBound lower_bound_;
+        Weight lower_bound_scale_ = Weight{ 1 };
+        // Incoming edges of vertex v are incoming_edges_[incoming_offsets_[v] .. incoming_offsets_[v + 1])
+        std::vector<size_t> incoming_offsets_;
+        std::vector<EdgeId> incoming_edges_;
+    };
+
+    template <typename Weight>
+    BidirectionalDijkstraRouter<Weight>::BidirectionalDijkstraRouter(const Graph& graph, LowerBound lower_bound,
+        const EdgeWeigher& edge_weigher)
+        : graph_(graph)
+        , lower_bound_(std::move(lower_bound))
+    {
+        const size_t vertex_count = graph_.GetVertexCount();
+        const size_t edge_count = graph_.GetEdgeCount();
+        if (edge_weigher) {
+            edge_weights_.reserve(edge_count);
+            for (const Edge<Weight>& edge : graph_) {
+                edge_weights_.push_back(edge_weigher(edge));
+            }
+        }
+
+        incoming_offsets_.assign(vertex_count + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            if (graph_.IsEdgeRemoved(edge_id)) {
+                continue;
+            }
+            const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+            const Weight weight = GetEdgeWeight(edge_id);
+            if (weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            ++incoming_offsets_[edge.to + 1];
+            if (lower_bound_) {
+                if (const Weight bound = lower_bound_(edge.from, edge.to); bound > ZERO_WEIGHT && weight < bound * lower_bound_scale_) {
+                    lower_bound_scale_ = weight / bound;
+                }
+            }
+        }
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+            incoming_offsets_[vertex + 1] += incoming_offsets_[vertex];
+        }
+        incoming_edges_.resize(incoming_offsets_.back());
+        std::vector<size_t> positions(incoming_offsets_.begin(), incoming_offsets_.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            if (!graph_.IsEdgeRemoved(edge_id)) {
+                incoming_edges_[positions[graph_.GetEdge(edge_id).to]++] = edge_id;
+            }
+        }
+    }
+
+    template <typename Weight>
+    Weight BidirectionalDijkstraRouter<Weight>::GetEdgeWeight(EdgeId edge_id) const {
+        return edge_weights_.empty() ? graph_.GetEdge(edge_id).weight : edge_weights_[edge_id];
+    }
+
+    template <typename Weight>
+    Weight BidirectionalDijkstraRouter<Weight>::GetPotential(VertexId vertex, VertexId from, VertexId to) const {
+        if (!lower_bound_) {
+            return ZERO_WEIGHT;
+        }
+        return (lower_bound_(vertex, to) - lower_bound_(from, vertex)) * lower_bound_scale_ / 2;
+    }
+
+    template <typename Weight>
+    std::optional<typename BidirectionalDijkstraRouter<Weight>::RouteInfo> BidirectionalDijkstraRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+
+        // Index 0 searches forward from `from`, index 1 backward from `to`
+        Search searches[2];
+        for (const auto& [side, vertex] : { std::pair{ 0, from }, std::pair{ 1, to } }) {
+            const Weight potential = side == 0 ? GetPotential(vertex, from, to) : -GetPotential(vertex, from, to);
+            searches[side].labels.emplace(vertex, Label{ ZERO_WEIGHT, potential, NO_EDGE });
+            searches[side].queue.push({ potential, ZERO_WEIGHT, vertex });
+        }
+
+        Weight best_weight = INFINITE_WEIGHT;
+        VertexId meeting_vertex = NO_VERTEX;
+        // The potentials of the two sides cancel out, so no route through an unscanned
+        // vertex is shorter than the sum of the smallest keys
+        while (!searches[0].queue.empty() && !searches[1].queue.empty()
+            && searches[0].GetTopKey() + searches[1].GetTopKey() < best_weight) {
+            const int side = searches[0].GetTopKey() <= searches[1].GetTopKey() ? 0 : 1;
+            Search& search = searches[side];
+            const Search& other_search = searches[1 - side];
+            const auto [key, weight, vertex] = search.queue.top();
+            search.queue.pop();
+            if (search.labels.at(vertex).weight < weight) {
+                continue;
+            }
+
+            const auto relax = [&, weight = weight](EdgeId edge_id, VertexId next_vertex) {
+                const Weight candidate_weight = weight + GetEdgeWeight(edge_id);
+                auto [it, inserted] = search.labels.try_emplace(next_vertex, Label{ INFINITE_WEIGHT, ZERO_WEIGHT, NO_EDGE });
+                Label& label = it->second;
+                if (inserted) {
+                    label.potential = side == 0 ? GetPotential(next_vertex, from, to) : -GetPotential(next_vertex, from, to);
+                }
+                if (!(candidate_weight < label.weight)) {
+                    return;
+                }
+                label.weight = candidate_weight;
+                label.prev_edge = edge_id;
+                search.queue.push({ candidate_weight + label.potential, candidate_weight, next_vertex });
+                if (const auto other_it = other_search.labels.find(next_vertex); other_it != other_search.labels.end()
+                    && candidate_weight + other_it->second.weight < best_weight) {
+                    best_weight = candidate_weight + other_it->second.weight;
+                    meeting_vertex = next_vertex;
+                }
+            };
+            if (side == 0) {
+                graph_.ForEachIncidentEdge(vertex, [&](EdgeId edge_id, VertexId next_vertex, const Weight&) {
+                    relax(edge_id, next_vertex);
+                });
+            }
+            else {
+                for (size_t i = incoming_offsets_[vertex]; i < incoming_offsets_[vertex + 1]; ++i) {
+                    relax(incoming_edges_[i], graph_.GetEdge(incoming_edges_[i]).from);
+                }
+            }
+        }
+
+        if (meeting_vertex == NO_VERTEX) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = searches[0].labels.at(meeting_vertex).prev_edge; edge_id != NO_EDGE;
+            edge_id = searches[0].labels.at(graph_.GetEdge(edge_id).from).prev_edge) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        for (EdgeId edge_id = searches[1].labels.at(meeting_vertex).prev_edge; edge_id != NO_EDGE;
+            edge_id = searches[1].labels.at(graph_.GetEdge(edge_id).to).prev_edge) {
+            edges.push_back(edge_id);
+        }
+        return RouteInfo{ best_weight, std::move(edges) };
+    }
+
+}  // namespace graph
@@ -0,0 +1,455 @@
+#pragma once
+
+#include "graph.h"
+#include "router_base.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Result of contracting every vertex of a graph. Arcs are the original edges
+    // (cheapest one per ordered vertex pair) plus the shortcuts added during contraction;
+    // a shortcut remembers the two arcs it replaces, so a route over arcs can be unpacked
+    // back into edge ids of the original graph.
+    template <typename Weight>
+    struct ContractionHierarchy {
+        static constexpr uint32_t NO_ARC = std::numeric_limits<uint32_t>::max();
+
+        struct Arc {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId edge_id;           // original edge, meaningful when children are NO_ARC
+            uint32_t first_child = NO_ARC;
+            uint32_t second_child = NO_ARC;
+
+            bool IsShortcut() const {
+                return first_child != NO_ARC;
+            }
+        };
+
+        std::vector<uint32_t> ranks;  // contraction order of every vertex
+        std::vector<Arc> arcs;
+    };
+
+    namespace detail {
+
+        template <typename Weight>
+        class ContractionHierarchyBuilder {
+        private:
+            using Hierarchy = ContractionHierarchy<Weight>;
+            using Arc = typename Hierarchy::Arc;
+
+        public:
+            explicit ContractionHierarchyBuilder(const DirectedWeightedGraph<Weight>& graph);
+
+            Hierarchy Build();
+
+        private:
+            struct Link {
+                VertexId vertex;
+                Weight weight;
+                uint32_t arc;
+            };
+
+            // Witness searches give up after settling this many vertices: a missed witness
+            // only costs a redundant shortcut, never a wrong answer
+            static constexpr size_t WITNESS_SETTLE_LIMIT = 500;
+            static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+
+            void AddArc(Arc arc);
+            // Stops early once every target is settled
+            void RunWitnessSearch(VertexId source, VertexId excluded, Weight max_weight, size_t target_count);
+            // Links to not contracted vertices, only the cheapest one per neighbour
+            std::vector<Link> GetCheapestLinks(const std::vector<Link>& links) const;
+            // Shortcuts contracting the vertex would need right now
+            std::vector<Arc> FindShortcuts(VertexId vertex);
+            int ComputePriority(VertexId vertex, size_t shortcut_count) const;
+
+            size_t vertex_count_;
+            Hierarchy hierarchy_;
+            std::vector<std::vector<Link>> out_links_;
+            std::vector<std::vector<Link>> in_links_;
+            std::vector<bool> contracted_;
+            std::vector<int> contracted_neighbours_;
+
+            std::vector<Weight> witness_weights_;
+            std::vector<VertexId> witness_touched_;
+            std::vector<bool> is_witness_target_;
+        };
+
+        template <typename Weight>
+        ContractionHierarchyBuilder<Weight>::ContractionHierarchyBuilder(const DirectedWeightedGraph<Weight>& graph)
+            : vertex_count_(graph.GetVertexCount())
+            , out_links_(vertex_count_)
+            , in_links_(vertex_count_)
+            , contracted_(vertex_count_, false)
+            , contracted_neighbours_(vertex_count_, 0)
+            , witness_weights_(vertex_count_, INFINITE_WEIGHT)
+            , is_witness_target_(vertex_count_, false)
+        {
+            // Only the cheapest of parallel edges can be a part of a shortest path
+            std::vector<EdgeId> edge_ids;
+            edge_ids.reserve(graph.GetEdgeCount());
+            for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+                if (!graph.IsEdgeRemoved(edge_id)) {
+                    edge_ids.push_back(edge_id);
+                }
+            }
+            std::sort(edge_ids.begin(), edge_ids.end(), [&graph](EdgeId lhs, EdgeId rhs) {
+                const auto& lhs_edge = graph.GetEdge(lhs);
+                const auto& rhs_edge = graph.GetEdge(rhs);
+                return std::tie(lhs_edge.from, lhs_edge.to, lhs_edge.weight, lhs)
+                    < std::tie(rhs_edge.from, rhs_edge.to, rhs_edge.weight, rhs);
+            });
+            for (size_t i = 0; i < edge_ids.size(); ++i) {
+                const auto& edge = graph.GetEdge(edge_ids[i]);
+                if (edge.weight < Weight{}) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                if (edge.from == edge.to) {
+                    continue;
+                }
+                if (i > 0) {
+                    const auto& prev_edge = graph.GetEdge(edge_ids[i - 1]);
+                    if (prev_edge.from == edge.from && prev_edge.to == edge.to) {
+                        continue;
+                    }
+                }
+                AddArc({ edge.from, edge.to, edge.weight, edge_ids[i] });
+            }
+        }
+
+        template <typename Weight>
+        void ContractionHierarchyBuilder<Weight>::AddArc(Arc arc) {
+            const uint32_t arc_id = static_cast<uint32_t>(hierarchy_.arcs.size());
+            out_links_[arc.from].push_back({ arc.to, arc.weight, arc_id });
+            in_links_[arc.to].push_back({ arc.from, arc.weight, arc_id });
+            hierarchy_.arcs.push_back(arc);
+        }
+
+        template <typename Weight>
+        void ContractionHierarchyBuilder<Weight>::RunWitnessSearch(VertexId source, VertexId excluded, Weight max_weight, size_t target_count) {
+            for (VertexId vertex : witness_touched_) {
+                witness_weights_[vertex] = INFINITE_WEIGHT;
+            }
+            witness_touched_.clear();
+
+            using QueueItem = std::pair<Weight, VertexId>;
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+            witness_weights_[source] = Weight{};
+            witness_touched_.push_back(source);
+            queue.push({ Weight{}, source });
+            size_t settled = 0;
+            while (!queue.empty() && settled < WITNESS_SETTLE_LIMIT && target_count > 0) {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (witness_weights_[vertex] < weight) {
+                    continue;
+                }
+                if (max_weight < weight) {
+                    break;
+                }
+                ++settled;
+                if (is_witness_target_[vertex]) {
+                    --target_count;
+                }
+                for (const Link& link : out_links_[vertex]) {
+                    if (link.vertex == excluded || contracted_[link.vertex]) {
+                        continue;
+                    }
+                    const Weight candidate_weight = weight + link.weight;
+                    if (candidate_weight < witness_weights_[link.vertex]) {
+                        if (witness_weights_[link.vertex] == INFINITE_WEIGHT) {
+                            witness_touched_.push_back(link.vertex);
+                        }
+                        witness_weights_[link.vertex] = candidate_weight;
+                        queue.push({ candidate_weight, link.vertex });
+                    }
+                }
+            }
+        }
+
+        template <typename Weight>
+        std::vector<typename ContractionHierarchyBuilder<Weight>::Link>
+            ContractionHierarchyBuilder<Weight>::GetCheapestLinks(const std::vector<Link>& links) const {
+            std::vector<Link> result;
+            for (const Link& link : links) {
+                if (!contracted_[link.vertex]) {
+                    result.push_back(link);
+                }
+            }
+            std::sort(result.begin(), result.end(), [](const Link& lhs, const Link& rhs) {
+                return std::tie(lhs.vertex, lhs.weight, lhs.arc) < std::tie(rhs.vertex, rhs.weight, rhs.arc);
+            });
+            result.erase(std::unique(result.begin(), result.end(), [](const Link& lhs, const Link& rhs) {
+                return lhs.vertex == rhs.vertex;
+            }), result.end());
+            return result;
+        }
+
+        template <typename Weight>
+        std::vector<typename ContractionHierarchyBuilder<Weight>::Arc> ContractionHierarchyBuilder<Weight>::FindShortcuts(VertexId vertex) {
+            std::vector<Arc> shortcuts;
+            const std::vector<Link> in_links = GetCheapestLinks(in_links_[vertex]);
+            const std::vector<Link> out_links = GetCheapestLinks(out_links_[vertex]);
+            if (in_links.empty() || out_links.empty()) {
+                return shortcuts;
+            }
+            Weight max_out_weight{};
+            for (const Link& out_link : out_links) {
+                max_out_weight = std::max(max_out_weight, out_link.weight);
+                is_witness_target_[out_link.vertex] = true;
+            }
+            for (const Link& in_link : in_links) {
+                RunWitnessSearch(in_link.vertex, vertex, in_link.weight + max_out_weight, out_links.size());
+                for (const Link& out_link : out_links) {
+                    if (out_link.vertex == in_link.vertex) {
+                        continue;
+                    }
+                    const Weight via_weight = in_link.weight + out_link.weight;
+                    if (witness_weights_[out_link.vertex] <= via_weight) {
+                        continue;
+                    }
+                    shortcuts.push_back({ in_link.vertex, out_link.vertex, via_weight, 0, in_link.arc, out_link.arc });
+                }
+            }
+            for (const Link& out_link : out_links) {
+                is_witness_target_[out_link.vertex] = false;
+            }
+            return shortcuts;
+        }
+
+        template <typename Weight>
+        int ContractionHierarchyBuilder<Weight>::ComputePriority(VertexId vertex, size_t shortcut_count) const {
+            int removed_links = 0;
+            for (const Link& link : in_links_[vertex]) {
+                removed_links += contracted_[link.vertex] ? 0 : 1;
+            }
+            for (const Link& link : out_links_[vertex]) {
+                removed_links += contracted_[link.vertex] ? 0 : 1;
+            }
+            // Edge difference plus the number of contracted neighbours, which spreads contraction evenly
+            return static_cast<int>(shortcut_count) - removed_links + contracted_neighbours_[vertex];
+        }
+
+        template <typename Weight>
+        typename ContractionHierarchyBuilder<Weight>::Hierarchy ContractionHierarchyBuilder<Weight>::Build() {
+            using QueueItem = std::pair<int, VertexId>;
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                queue.push({ ComputePriority(vertex, FindShortcuts(vertex).size()), vertex });
+            }
+
+            hierarchy_.ranks.assign(vertex_count_, 0);
+            uint32_t next_rank = 0;
+            while (!queue.empty()) {
+                const VertexId vertex = queue.top().second;
+                queue.pop();
+                // Lazy update: priorities of the queued vertices may be outdated
+                std::vector<Arc> shortcuts = FindShortcuts(vertex);
+                const int priority = ComputePriority(vertex, shortcuts.size());
+                if (!queue.empty() && priority > queue.top().first) {
+                    queue.push({ priority, vertex });
+                    continue;
+                }
+                for (const Arc& shortcut : shortcuts) {
+                    AddArc(shortcut);
+                }
+                contracted_[vertex] = true;
+                hierarchy_.ranks[vertex] = next_rank++;
+                for (const Link& link : in_links_[vertex]) {
+                    ++contracted_neighbours_[link.vertex];
+                }
+                for (const Link& link : out_links_[vertex]) {
+                    ++contracted_neighbours_[link.vertex];
+                }
+            }
+            return std::move(hierarchy_);
+        }
+
+    }  // namespace detail
+
+    template <typename Weight>
+    ContractionHierarchy<Weight> BuildContractionHierarchy(const DirectedWeightedGraph<Weight>& graph) {
+        return detail::ContractionHierarchyBuilder<Weight>(graph).Build();
+    }
+
+    // Answers queries with a bidirectional search that only goes up the hierarchy:
+    // forward from the source over arcs to higher ranks, backward from the target over
+    // arcs coming from higher ranks.
+    template <typename Weight>
+    class ContractionHierarchyRouter : public RouterBase<Weight> {
+    private:
+        using Hierarchy = ContractionHierarchy<Weight>;
+        using Arc = typename Hierarchy::Arc;
+
+    public:
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+
+        explicit ContractionHierarchyRouter(std::shared_ptr<const Hierarchy> hierarchy);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    private:
+        struct Label {
+            Weight weight;
+            uint32_t arc;
+        };
+        using Labels = std::unordered_map<VertexId, Label>;
+
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+
+        void UnpackArc(uint32_t arc_id, std::vector<EdgeId>& edges) const;
+
+        std::shared_ptr<const Hierarchy> hierarchy_ptr_;
+        const Hierarchy& hierarchy_;
+        // Upward arcs by their lower end: outgoing for the forward search, incoming for the backward one
+        std::vector<size_t> up_offsets_;
+        std::vector<uint32_t> up_arcs_;
+        std::vector<size_t> down_offsets_;
+        std::vector<uint32_t> down_arcs_;
+    };
+
+    template <typename Weight>
+    ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(std::shared_ptr<const Hierarchy> hierarchy)
+        : hierarchy_ptr_(std::move(hierarchy))
+        , hierarchy_(*hierarchy_ptr_)
+    {
+        const size_t vertex_count = hierarchy_.ranks.size();
+        up_offsets_.assign(vertex_count + 1, 0);
+        down_offsets_.assign(vertex_count + 1, 0);
+        for (const Arc& arc : hierarchy_.arcs) {
+            if (hierarchy_.ranks[arc.from] < hierarchy_.ranks[arc.to]) {
+                ++up_offsets_[arc.from + 1];
+            }
+            else {
+                ++down_offsets_[arc.to + 1];
+            }
+        }
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+            up_offsets_[vertex + 1] += up_offsets_[vertex];
+            down_offsets_[vertex + 1] += down_offsets_[vertex];
+        }
+        up_arcs_.resize(up_offsets_.back());
+        down_arcs_.resize(down_offsets_.back());
+        std::vector<size_t> up_positions(up_offsets_.begin(), up_offsets_.end() - 1);
+        std::vector<size_t> down_positions(down_offsets_.begin(), down_offsets_.end() - 1);
+        for (uint32_t arc_id = 0; arc_id < hierarchy_.arcs.size(); ++arc_id) {
+            const Arc& arc = hierarchy_.arcs[arc_id];
+            if (hierarchy_.ranks[arc.from] < hierarchy_.ranks[arc.to]) {
+                up_arcs_[up_positions[arc.from]++] = arc_id;
+            }
+            else {
+                down_arcs_[down_positions[arc.to]++] = arc_id;
+            }
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchyRouter<Weight>::UnpackArc(uint32_t arc_id, std::vector<EdgeId>& edges) const {
+        std::vector<uint32_t> stack{ arc_id };
+        while (!stack.empty()) {
+            const Arc& arc = hierarchy_.arcs[stack.back()];
+            stack.pop_back();
+            if (arc.IsShortcut()) {
+                stack.push_back(arc.second_child);
+                stack.push_back(arc.first_child);
+            }
+            else {
+                edges.push_back(arc.edge_id);
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo> ContractionHierarchyRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        const size_t vertex_count = hierarchy_.ranks.size();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+        Labels forward_labels{ { from, { Weight{}, Hierarchy::NO_ARC } } };
+        Labels backward_labels{ { to, { Weight{}, Hierarchy::NO_ARC } } };
+        Queue forward_queue;
+        Queue backward_queue;
+        forward_queue.push({ Weight{}, from });
+        backward_queue.push({ Weight{}, to });
+
+        Weight best_weight = INFINITE_WEIGHT;
+        VertexId meeting_vertex = vertex_count;
+
+        auto settle = [&](Queue& queue, Labels& labels, const Labels& opposite_labels, bool forward) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (labels.at(vertex).weight < weight) {
+                return;
+            }
+            if (const auto it = opposite_labels.find(vertex); it != opposite_labels.end() && weight + it->second.weight < best_weight) {
+                best_weight = weight + it->second.weight;
+                meeting_vertex = vertex;
+            }
+            const auto& offsets = forward ? up_offsets_ : down_offsets_;
+            const auto& arcs = forward ? up_arcs_ : down_arcs_;
+            for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const Arc& arc = hierarchy_.arcs[arcs[i]];
+                const VertexId next_vertex = forward ? arc.to : arc.from;
+                const Weight candidate_weight = weight + arc.weight;
+                auto [it, inserted] = labels.try_emplace(next_vertex, Label{ candidate_weight, arcs[i] });
+                if (inserted || candidate_weight < it->second.weight) {
+                    it->second = { candidate_weight, arcs[i] };
+                    queue.push({ candidate_weight, next_vertex });
+                }
+            }
+        };
+
+        while (true) {
+            const bool forward_open = !forward_queue.empty() && forward_queue.top().first < best_weight;
+            const bool backward_open = !backward_queue.empty() && backward_queue.top().first < best_weight;
+            if (!forward_open && !backward_open) {
+                break;
+            }
+            if (forward_open && (!backward_open || forward_queue.top().first <= backward_queue.top().first)) {
+                settle(forward_queue, forward_labels, backward_labels, true);
+            }
+            else {
+                settle(backward_queue, backward_labels, forward_labels, false);
+            }
+        }
+
+        if (meeting_vertex == vertex_count) {
+            return std::nullopt;
+        }
+
+        std::vector<uint32_t> forward_arcs;
+        for (uint32_t arc_id = forward_labels.at(meeting_vertex).arc; arc_id != Hierarchy::NO_ARC;
+            arc_id = forward_labels.at(hierarchy_.arcs[arc_id].from).arc) {
+            forward_arcs.push_back(arc_id);
+        }
+        std::vector<EdgeId> edges;
+        for (auto it = forward_arcs.rbegin(); it != forward_arcs.rend(); ++it) {
+            UnpackArc(*it, edges);
+        }
+        for (uint32_t arc_id = backward_labels.at(meeting_vertex).arc; arc_id != Hierarchy::NO_ARC;
+            arc_id = backward_labels.at(hierarchy_.arcs[arc_id].to).arc) {
+            UnpackArc(arc_id, edges);
+        }
+
+        return RouteInfo{ best_weight, std::move(edges) };
+    }
+
+}  // namespace graph
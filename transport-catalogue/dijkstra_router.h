@@ -0,0 +1,196 @@
+#pragma once
+
+#include "graph.h"
+#include "router_base.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Answers each query with a single-source Dijkstra run instead of
+    // precomputing all pairs. Shortest-path trees are memoized per source,
+    // so repeated queries from the same stop cost only the path unpacking.
+    template <typename Weight>
+    class DijkstraRouter : public RouterBase<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+        using EdgeWeigher = std::function<Weight(const Edge<Weight>&)>;
+
+        static constexpr size_t UNLIMITED_TREES = std::numeric_limits<size_t>::max();
+
+        // Trees of sources beyond the first max_memoized_trees are built anew for every query
+        explicit DijkstraRouter(const Graph& graph, size_t max_memoized_trees = UNLIMITED_TREES);
+        // Routes by edge_weigher(edge) instead of the weights stored in the graph
+        DijkstraRouter(const Graph& graph, const EdgeWeigher& edge_weigher, size_t max_memoized_trees = UNLIMITED_TREES);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        // Searches once without memoizing the tree, unless it's memoized already
+        std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const override;
+        // Bytes a memoized tree of a graph with vertex_count vertices takes
+        static size_t EstimateTreeMemoryUsage(size_t vertex_count);
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        struct ShortestPathTree {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+        };
+
+        ShortestPathTree BuildShortestPathTree(VertexId from) const;
+        // The memoized tree, or own_tree once there's no room for another one
+        const ShortestPathTree& GetShortestPathTree(VertexId from, std::optional<ShortestPathTree>& own_tree) const;
+        std::optional<RouteInfo> UnpackRoute(const ShortestPathTree& tree, VertexId to) const;
+
+        const Graph& graph_;
+        // Empty unless the router was given its own weigher
+        std::vector<Weight> edge_weights_;
+        size_t max_memoized_trees_;
+        mutable std::mutex trees_mutex_;
+        mutable std::unordered_map<VertexId, std::unique_ptr<ShortestPathTree>> trees_;
+    };
+
+    template <typename Weight>
+    DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, size_t max_memoized_trees)
+        : graph_(graph)
+        , max_memoized_trees_(max_memoized_trees)
+    {
+        for (const Edge<Weight>& edge : graph_) {
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template <typename Weight>
+    DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, const EdgeWeigher& edge_weigher, size_t max_memoized_trees)
+        : graph_(graph)
+        , max_memoized_trees_(max_memoized_trees)
+    {
+        edge_weights_.reserve(graph_.GetEdgeCount());
+        for (const Edge<Weight>& edge : graph_) {
+            edge_weights_.push_back(edge_weigher(edge));
+            if (edge_weights_.back() < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template <typename Weight>
+    typename DijkstraRouter<Weight>::ShortestPathTree DijkstraRouter<Weight>::BuildShortestPathTree(VertexId from) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        ShortestPathTree tree{ std::vector<Weight>(vertex_count, INFINITE_WEIGHT), std::vector<EdgeId>(vertex_count, NO_EDGE) };
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        tree.weights[from] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, from });
+
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (tree.weights[vertex] < weight) {
+                continue;
+            }
+            graph_.ForEachIncidentEdge(vertex, [&, weight = weight](EdgeId edge_id, VertexId to, const Weight& edge_weight) {
+                const Weight candidate_weight = weight + (edge_weights_.empty() ? edge_weight : edge_weights_[edge_id]);
+                if (candidate_weight < tree.weights[to]) {
+                    tree.weights[to] = candidate_weight;
+                    tree.prev_edges[to] = edge_id;
+                    queue.push({ candidate_weight, to });
+                }
+            });
+        }
+        return tree;
+    }
+
+    template <typename Weight>
+    const typename DijkstraRouter<Weight>::ShortestPathTree& DijkstraRouter<Weight>::GetShortestPathTree(VertexId from,
+        std::optional<ShortestPathTree>& own_tree) const {
+        {
+            std::lock_guard guard(trees_mutex_);
+            if (const auto it = trees_.find(from); it != trees_.end()) {
+                return *it->second;
+            }
+        }
+        // Built outside the lock: two threads racing on the same source
+        // compute identical trees and the first one stored wins.
+        auto tree = std::make_unique<ShortestPathTree>(BuildShortestPathTree(from));
+        std::lock_guard guard(trees_mutex_);
+        if (trees_.count(from) != 0 || trees_.size() < max_memoized_trees_) {
+            return *trees_.emplace(from, std::move(tree)).first->second;
+        }
+        return own_tree.emplace(std::move(*tree));
+    }
+
+    template <typename Weight>
+    size_t DijkstraRouter<Weight>::EstimateTreeMemoryUsage(size_t vertex_count) {
+        return vertex_count * (sizeof(Weight) + sizeof(EdgeId));
+    }
+
+    template <typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        std::optional<ShortestPathTree> own_tree;
+        return UnpackRoute(GetShortestPathTree(from, own_tree), to);
+    }
+
+    template <typename Weight>
+    std::vector<std::optional<typename DijkstraRouter<Weight>::RouteInfo>> DijkstraRouter<Weight>::BuildRoutes(VertexId from,
+        const std::vector<VertexId>& targets) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || std::any_of(targets.begin(), targets.end(), [vertex_count](VertexId to) { return to >= vertex_count; })) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        std::optional<ShortestPathTree> own_tree;
+        const ShortestPathTree* tree = nullptr;
+        {
+            std::lock_guard guard(trees_mutex_);
+            if (const auto it = trees_.find(from); it != trees_.end()) {
+                tree = it->second.get();
+            }
+        }
+        if (!tree) {
+            tree = &own_tree.emplace(BuildShortestPathTree(from));
+        }
+        std::vector<std::optional<RouteInfo>> routes;
+        routes.reserve(targets.size());
+        for (const VertexId to : targets) {
+            routes.push_back(UnpackRoute(*tree, to));
+        }
+        return routes;
+    }
+
+    template <typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::UnpackRoute(const ShortestPathTree& tree, VertexId to) const {
+        if (tree.weights[to] == INFINITE_WEIGHT) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = tree.prev_edges[to]; edge_id != NO_EDGE; edge_id = tree.prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{ tree.weights[to], std::move(edges) };
+    }
+
+}  // namespace graph
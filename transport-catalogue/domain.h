@@ -1,16 +1,24 @@
 #pragma once
 #include "geo.h"
+#include "graph.h"
 #include "json.h"
 
+#include <cstdint>
 #include <vector>
 #include <string>
 
 namespace transport_catalogue
 {
+	//Dense ids given in insertion order: a stop id is also its graph vertex
+	//and protobuf index, a bus id is what graph edges store
+	using StopId = uint32_t;
+	using BusId = graph::BusId;
+
 	struct Stop
 	{
 		std::string name;
 		coordinates::Coordinates coordinates;
+		StopId id = 0;
 	};
 
 	inline bool operator==(const Stop& lhs, const Stop& rhs)
@@ -24,10 +32,67 @@ namespace transport_catalogue
 		bool is_looped;
 	};
 
+	enum class RouterEngine
+	{
+		ALL_PAIRS,
+		DIJKSTRA,
+		CONTRACTION_HIERARCHIES,
+		RAPTOR,
+		BIDIRECTIONAL_DIJKSTRA,
+		BIDIRECTIONAL_ASTAR,
+		HUB_LABELS
+	};
+
+	enum class GraphModel
+	{
+		//Edge for every pair of stops of a bus: O(stops^2) edges per bus
+		PAIRWISE,
+		//Boarding, riding and alighting edges over per-bus ride vertices: O(stops) edges per bus
+		LINEAR
+	};
+
+	//Order the ids of stops, and so the vertices of the graph, are given in by make_base
+	enum class StopOrder
+	{
+		INPUT,
+		//Along a Hilbert curve over the stops' coordinates, so that neighbouring stops get nearby
+		//ids; buses follow their first stops, so that their edges and ride vertices do the same
+		HILBERT
+	};
+
+	//Weights the routers built at query time keep in their tables
+	enum class RouterWeights
+	{
+		DOUBLE,
+		//Half the memory, routes are chosen by weights rounded to float but timed in double
+		FLOAT
+	};
+
 	struct RouteSettings
 	{
 		int bus_wait_time;
 		double bus_velocity;
+		RouterEngine router_engine = RouterEngine::ALL_PAIRS;
+		bool precompute_routes = false;
+		//Threads used to build the all-pairs router and to answer Route requests, 0 - all hardware threads
+		size_t router_threads = 1;
+		GraphModel graph_model = GraphModel::PAIRWISE;
+		//Drop the parallel edges that can't be a part of a shortest route. Updates of a compacted
+		//base rebuild the graph, a dropped edge may be needed again
+		bool compact_graph = false;
+		StopOrder stop_order = StopOrder::INPUT;
+		//Rides limit of the raptor engine, 0 - unlimited
+		size_t raptor_max_rounds = 0;
+		//Bytes the precomputed routes may take, 0 - unlimited. An all-pairs table over the budget
+		//isn't built, the routes are searched on demand instead
+		size_t router_memory_budget = 0;
+		RouterWeights router_weights = RouterWeights::DOUBLE;
+		//Threads used to build the graph, 0 - all hardware threads
+		size_t graph_threads = 1;
+		//Memory the answers of Route requests may be cached in, 0 - no cache
+		size_t route_cache_budget = 0;
+		//Parts of the cache locked independently, fewer threads wait on each other with more of them
+		size_t route_cache_shards = 16;
 	};
 
 	struct Bus
@@ -35,6 +100,9 @@ namespace transport_catalogue
 		std::string name;
 		std::vector<const Stop*> stops;
 		bool is_looped;
+		BusId id = 0;
+		//A removed bus keeps its id, so that the ids of the others don't change
+		bool is_removed = false;
 	};
 
 	namespace json_reader
@@ -2,6 +2,8 @@
 #define _USE_MATH_DEFINES
 
 #include <cmath>
+#include <cstdint>
+#include <utility>
 //#include <corecrt_math_defines.h>
 
 namespace transport_catalogue
@@ -40,6 +42,42 @@ namespace transport_catalogue
                 * EARTH_RADIUS;
 
         }
+
+        //Position of the point along a Hilbert curve drawn over the box from min to max on a
+        //65536 x 65536 grid. Points close along the curve are close on the map as well
+        inline uint64_t ComputeHilbertIndex(Coordinates point, Coordinates min, Coordinates max)
+        {
+            const uint32_t GRID_SIDE = 1 << 16;
+            const auto to_cell = [GRID_SIDE](double value, double min_value, double max_value)
+            {
+                if (max_value <= min_value)
+                {
+                    return 0u;
+                }
+                const double cell = (value - min_value) / (max_value - min_value) * GRID_SIDE;
+                return cell <= 0 ? 0u : cell >= GRID_SIDE - 1 ? GRID_SIDE - 1 : static_cast<uint32_t>(cell);
+            };
+            uint32_t x = to_cell(point.lng, min.lng, max.lng);
+            uint32_t y = to_cell(point.lat, min.lat, max.lat);
+            uint64_t index = 0;
+            for (uint32_t side = GRID_SIDE / 2; side > 0; side /= 2)
+            {
+                const uint32_t rx = (x & side) > 0;
+                const uint32_t ry = (y & side) > 0;
+                index += static_cast<uint64_t>(side) * side * ((3 * rx) ^ ry);
+                //Rotate the quadrant so that the curve inside it starts and ends where it should
+                if (ry == 0)
+                {
+                    if (rx == 1)
+                    {
+                        x = side - 1 - (x & (side - 1));
+                        y = side - 1 - (y & (side - 1));
+                    }
+                    std::swap(x, y);
+                }
+            }
+            return index;
+        }
     }
 }
 
@@ -2,7 +2,10 @@
 
 #include "ranges.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <stdexcept>
 #include <vector>
 #include <string>
 
@@ -10,6 +13,8 @@ namespace graph {
 
     using VertexId = size_t;
     using EdgeId = size_t;
+    // Index of the bus in the catalogue, its name is looked up there
+    using BusId = uint32_t;
 
     template <typename Weight>
     struct Edge 
@@ -17,8 +22,10 @@ namespace graph {
         VertexId from;
         VertexId to;
         uint32_t span_count;
-        std::string bus_name;
+        BusId bus_id;
         Weight weight;
+        // Meters ridden along the edge, lets the weight be recomputed for other settings
+        double distance = 0;
     };
 
     template <typename Weight>
@@ -32,11 +39,32 @@ namespace graph {
         explicit DirectedWeightedGraph(size_t vertex_count);
         EdgeId AddEdge(const Edge<Weight>& edge);
 
+        // Packs the incidence lists into compressed sparse rows, after that no edges can be added
+        void Freeze();
+        // Unpacks the rows back into incidence lists so that the graph can be changed again
+        void Thaw();
+        bool IsFrozen() const;
+
+        // Adds isolated vertices, returns the id of the first one
+        VertexId AddVertices(size_t count);
+        // Removed edges keep their ids but leave the incidence lists
+        void RemoveEdge(EdgeId edge_id);
+        // Same for many edges, each incidence list is compacted once
+        void RemoveEdges(const std::vector<EdgeId>& edge_ids);
+        bool IsEdgeRemoved(EdgeId edge_id) const;
+        void SetEdgeWeight(EdgeId edge_id, const Weight& weight);
+        void SetEdgeDistance(EdgeId edge_id, double distance);
+
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
         const Edge<Weight>& GetEdge(EdgeId edge_id) const;
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+        // Calls func(edge_id, to, weight) for each edge leaving the vertex,
+        // a frozen graph reads them from contiguous arrays without touching the edges
+        template <typename Func>
+        void ForEachIncidentEdge(VertexId vertex, Func func) const;
+
         typename std::vector<Edge<Weight>>::const_iterator begin() const 
         {
             return edges_.begin();
@@ -47,26 +75,156 @@ namespace graph {
         }
 
     private:
+        size_t vertex_count_ = 0;
         std::vector<Edge<Weight>> edges_;
+        std::vector<bool> removed_edges_;
         std::vector<IncidenceList> incidence_lists_;
+
+        // Compressed sparse rows of a frozen graph: the edges leaving vertex v
+        // occupy positions [row_offsets_[v], row_offsets_[v + 1]) of the arrays below
+        bool frozen_ = false;
+        std::vector<size_t> row_offsets_;
+        IncidenceList row_edge_ids_;
+        std::vector<VertexId> row_targets_;
+        std::vector<Weight> row_weights_;
     };
 
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-        : incidence_lists_(vertex_count) {
+        : vertex_count_(vertex_count)
+        , incidence_lists_(vertex_count) {
     }
 
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+        if (frozen_) {
+            throw std::logic_error("Can't add an edge to a frozen graph");
+        }
         edges_.push_back(edge);
+        removed_edges_.push_back(false);
         const EdgeId id = edges_.size() - 1;
         incidence_lists_.at(edge.from).push_back(id);
         return id;
     }
 
+    template <typename Weight>
+    VertexId DirectedWeightedGraph<Weight>::AddVertices(size_t count) {
+        if (frozen_) {
+            throw std::logic_error("Can't add a vertex to a frozen graph");
+        }
+        const VertexId first_vertex = vertex_count_;
+        vertex_count_ += count;
+        incidence_lists_.resize(vertex_count_);
+        return first_vertex;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::RemoveEdge(EdgeId edge_id) {
+        if (frozen_) {
+            throw std::logic_error("Can't remove an edge from a frozen graph");
+        }
+        if (removed_edges_.at(edge_id)) {
+            return;
+        }
+        IncidenceList& incidence_list = incidence_lists_[edges_[edge_id].from];
+        incidence_list.erase(std::find(incidence_list.begin(), incidence_list.end(), edge_id));
+        removed_edges_[edge_id] = true;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::RemoveEdges(const std::vector<EdgeId>& edge_ids) {
+        if (frozen_) {
+            throw std::logic_error("Can't remove an edge from a frozen graph");
+        }
+        std::vector<VertexId> affected_vertices;
+        for (const EdgeId edge_id : edge_ids) {
+            if (!removed_edges_.at(edge_id)) {
+                removed_edges_[edge_id] = true;
+                affected_vertices.push_back(edges_[edge_id].from);
+            }
+        }
+        std::sort(affected_vertices.begin(), affected_vertices.end());
+        affected_vertices.erase(std::unique(affected_vertices.begin(), affected_vertices.end()), affected_vertices.end());
+        for (const VertexId vertex : affected_vertices) {
+            IncidenceList& incidence_list = incidence_lists_[vertex];
+            incidence_list.erase(std::remove_if(incidence_list.begin(), incidence_list.end(), [this](EdgeId edge_id) {
+                return removed_edges_[edge_id];
+            }), incidence_list.end());
+        }
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::IsEdgeRemoved(EdgeId edge_id) const {
+        return removed_edges_.at(edge_id);
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::SetEdgeWeight(EdgeId edge_id, const Weight& weight) {
+        Edge<Weight>& edge = edges_.at(edge_id);
+        edge.weight = weight;
+        if (frozen_ && !removed_edges_[edge_id]) {
+            const size_t row_end = row_offsets_[edge.from + 1];
+            for (size_t i = row_offsets_[edge.from]; i != row_end; ++i) {
+                if (row_edge_ids_[i] == edge_id) {
+                    row_weights_[i] = weight;
+                    break;
+                }
+            }
+        }
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::Freeze() {
+        if (frozen_) {
+            return;
+        }
+        row_offsets_.reserve(vertex_count_ + 1);
+        row_edge_ids_.reserve(edges_.size());
+        row_targets_.reserve(edges_.size());
+        row_weights_.reserve(edges_.size());
+        row_offsets_.push_back(0);
+        for (const IncidenceList& incidence_list : incidence_lists_) {
+            for (const EdgeId edge_id : incidence_list) {
+                const Edge<Weight>& edge = edges_[edge_id];
+                row_edge_ids_.push_back(edge_id);
+                row_targets_.push_back(edge.to);
+                row_weights_.push_back(edge.weight);
+            }
+            row_offsets_.push_back(row_edge_ids_.size());
+        }
+        std::vector<IncidenceList>().swap(incidence_lists_);
+        frozen_ = true;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::Thaw() {
+        if (!frozen_) {
+            return;
+        }
+        incidence_lists_.resize(vertex_count_);
+        for (VertexId vertex = 0; vertex != vertex_count_; ++vertex) {
+            incidence_lists_[vertex].assign(row_edge_ids_.begin() + row_offsets_[vertex], row_edge_ids_.begin() + row_offsets_[vertex + 1]);
+        }
+        std::vector<size_t>().swap(row_offsets_);
+        IncidenceList().swap(row_edge_ids_);
+        std::vector<VertexId>().swap(row_targets_);
+        std::vector<Weight>().swap(row_weights_);
+        frozen_ = false;
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+        return frozen_;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::SetEdgeDistance(EdgeId edge_id, double distance) {
+        edges_.at(edge_id).distance = distance;
+    }
+
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-        return incidence_lists_.size();
+        return vertex_count_;
     }
 
     template <typename Weight>
@@ -82,6 +240,31 @@ namespace graph {
     template <typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
         DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+        if (frozen_) {
+            if (vertex >= vertex_count_) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            return ranges::Range(row_edge_ids_.begin() + row_offsets_[vertex], row_edge_ids_.begin() + row_offsets_[vertex + 1]);
+        }
         return ranges::AsRange(incidence_lists_.at(vertex));
     }
+
+    template <typename Weight>
+    template <typename Func>
+    void DirectedWeightedGraph<Weight>::ForEachIncidentEdge(VertexId vertex, Func func) const {
+        if (frozen_) {
+            if (vertex >= vertex_count_) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            const size_t row_end = row_offsets_[vertex + 1];
+            for (size_t i = row_offsets_[vertex]; i != row_end; ++i) {
+                func(row_edge_ids_[i], row_targets_[i], row_weights_[i]);
+            }
+            return;
+        }
+        for (const EdgeId edge_id : incidence_lists_.at(vertex)) {
+            const Edge<Weight>& edge = edges_[edge_id];
+            func(edge_id, edge.to, edge.weight);
+        }
+    }
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,334 @@
+#pragma once
+
+#include "graph.h"
+#include "router_base.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // 2-hop cover of the shortest routes of a graph: every vertex keeps the weights of its
+    // routes to and from a set of hubs, so that any route runs through a hub both ends know.
+    // Besides the weight an entry keeps the next edge towards the hub (or from it), which
+    // is enough to unpack a route: the vertices along it have an entry of the same hub.
+    template <typename Weight>
+    struct HubLabels {
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        // Entries of vertex v are [offsets[v], offsets[v + 1]) of the other vectors, by ascending hub rank
+        struct LabelSet {
+            std::vector<size_t> offsets;
+            std::vector<uint32_t> hubs;
+            std::vector<Weight> weights;
+            // Out labels: the first edge from the vertex towards the hub;
+            // in labels: the last edge from the hub to the vertex; NO_EDGE at the hub itself
+            std::vector<EdgeId> edges;
+        };
+
+        // Routes from the vertices to their hubs
+        LabelSet out_labels;
+        // Routes from the hubs to the vertices
+        LabelSet in_labels;
+
+        size_t GetVertexCount() const {
+            return out_labels.offsets.empty() ? 0 : out_labels.offsets.size() - 1;
+        }
+
+        size_t GetEntryCount() const {
+            return out_labels.hubs.size() + in_labels.hubs.size();
+        }
+
+        size_t GetMemoryUsage() const {
+            return GetEntryCount() * (sizeof(uint32_t) + sizeof(Weight) + sizeof(EdgeId))
+                + (out_labels.offsets.size() + in_labels.offsets.size()) * sizeof(size_t);
+        }
+    };
+
+    namespace detail {
+
+        // Pruned landmark labeling: vertices become hubs one by one, most connected first;
+        // each hub runs a Dijkstra search both ways that stops at the vertices whose route
+        // is already covered by the hubs processed before.
+        template <typename Weight>
+        class HubLabelsBuilder {
+        private:
+            using Labels = HubLabels<Weight>;
+
+        public:
+            explicit HubLabelsBuilder(const DirectedWeightedGraph<Weight>& graph);
+
+            Labels Build();
+
+        private:
+            struct Entry {
+                uint32_t hub;
+                Weight weight;
+                EdgeId edge_id;
+            };
+
+            static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+
+            // forward: routes from the hub, stored in in_entries_; otherwise routes to it, in out_entries_
+            void RunPrunedSearch(VertexId hub, uint32_t rank, bool forward);
+            static typename Labels::LabelSet Flatten(std::vector<std::vector<Entry>>& entries);
+
+            const DirectedWeightedGraph<Weight>& graph_;
+            size_t vertex_count_;
+            std::vector<size_t> incoming_offsets_;
+            std::vector<EdgeId> incoming_edges_;
+            std::vector<std::vector<Entry>> out_entries_;
+            std::vector<std::vector<Entry>> in_entries_;
+
+            // Scratch of a search: the hub's own entries by rank, tentative weights and edges
+            std::vector<Weight> hub_weights_;
+            std::vector<Weight> weights_;
+            std::vector<EdgeId> edges_;
+            std::vector<VertexId> touched_;
+        };
+
+        template <typename Weight>
+        HubLabelsBuilder<Weight>::HubLabelsBuilder(const DirectedWeightedGraph<Weight>& graph)
+            : graph_(graph)
+            , vertex_count_(graph.GetVertexCount())
+            , out_entries_(vertex_count_)
+            , in_entries_(vertex_count_)
+            , hub_weights_(vertex_count_, INFINITE_WEIGHT)
+            , weights_(vertex_count_, INFINITE_WEIGHT)
+            , edges_(vertex_count_, Labels::NO_EDGE)
+        {
+            incoming_offsets_.assign(vertex_count_ + 1, 0);
+            for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+                if (!graph_.IsEdgeRemoved(edge_id)) {
+                    if (graph_.GetEdge(edge_id).weight < Weight{}) {
+                        throw std::domain_error("Edges' weights should be non-negative");
+                    }
+                    ++incoming_offsets_[graph_.GetEdge(edge_id).to + 1];
+                }
+            }
+            for (size_t vertex = 0; vertex < vertex_count_; ++vertex) {
+                incoming_offsets_[vertex + 1] += incoming_offsets_[vertex];
+            }
+            incoming_edges_.resize(incoming_offsets_.back());
+            std::vector<size_t> positions(incoming_offsets_.begin(), incoming_offsets_.end() - 1);
+            for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+                if (!graph_.IsEdgeRemoved(edge_id)) {
+                    incoming_edges_[positions[graph_.GetEdge(edge_id).to]++] = edge_id;
+                }
+            }
+        }
+
+        template <typename Weight>
+        HubLabels<Weight> HubLabelsBuilder<Weight>::Build() {
+            std::vector<size_t> degrees(vertex_count_);
+            std::vector<VertexId> order(vertex_count_);
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                order[vertex] = vertex;
+                degrees[vertex] = incoming_offsets_[vertex + 1] - incoming_offsets_[vertex];
+                graph_.ForEachIncidentEdge(vertex, [&](EdgeId, VertexId, const Weight&) {
+                    ++degrees[vertex];
+                });
+            }
+            std::stable_sort(order.begin(), order.end(), [&degrees](VertexId lhs, VertexId rhs) {
+                return degrees[lhs] > degrees[rhs];
+            });
+
+            for (uint32_t rank = 0; rank < vertex_count_; ++rank) {
+                RunPrunedSearch(order[rank], rank, true);
+                RunPrunedSearch(order[rank], rank, false);
+            }
+            return Labels{ Flatten(out_entries_), Flatten(in_entries_) };
+        }
+
+        template <typename Weight>
+        void HubLabelsBuilder<Weight>::RunPrunedSearch(VertexId hub, uint32_t rank, bool forward) {
+            // A vertex is covered when some earlier hub already gives a route as short:
+            // hub -> earlier hub -> vertex going forward, vertex -> earlier hub -> hub backward
+            std::vector<std::vector<Entry>>& hub_entries = forward ? out_entries_ : in_entries_;
+            std::vector<std::vector<Entry>>& vertex_entries = forward ? in_entries_ : out_entries_;
+            for (const Entry& entry : hub_entries[hub]) {
+                hub_weights_[entry.hub] = entry.weight;
+            }
+
+            using QueueItem = std::pair<Weight, VertexId>;
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+            weights_[hub] = Weight{};
+            touched_.push_back(hub);
+            queue.push({ Weight{}, hub });
+            while (!queue.empty()) {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (weights_[vertex] < weight) {
+                    continue;
+                }
+                const bool is_covered = std::any_of(vertex_entries[vertex].begin(), vertex_entries[vertex].end(),
+                    [this, weight = weight](const Entry& entry) {
+                        return hub_weights_[entry.hub] != INFINITE_WEIGHT && !(weight < hub_weights_[entry.hub] + entry.weight);
+                    });
+                if (is_covered) {
+                    continue;
+                }
+                vertex_entries[vertex].push_back({ rank, weight, edges_[vertex] });
+
+                const auto relax = [&, weight = weight](EdgeId edge_id, VertexId next_vertex, const Weight& edge_weight) {
+                    const Weight candidate_weight = weight + edge_weight;
+                    if (candidate_weight < weights_[next_vertex]) {
+                        if (weights_[next_vertex] == INFINITE_WEIGHT) {
+                            touched_.push_back(next_vertex);
+                        }
+                        weights_[next_vertex] = candidate_weight;
+                        edges_[next_vertex] = edge_id;
+                        queue.push({ candidate_weight, next_vertex });
+                    }
+                };
+                if (forward) {
+                    graph_.ForEachIncidentEdge(vertex, relax);
+                }
+                else {
+                    for (size_t i = incoming_offsets_[vertex]; i < incoming_offsets_[vertex + 1]; ++i) {
+                        const Edge<Weight>& edge = graph_.GetEdge(incoming_edges_[i]);
+                        relax(incoming_edges_[i], edge.from, edge.weight);
+                    }
+                }
+            }
+
+            for (const VertexId vertex : touched_) {
+                weights_[vertex] = INFINITE_WEIGHT;
+                edges_[vertex] = Labels::NO_EDGE;
+            }
+            touched_.clear();
+            for (const Entry& entry : hub_entries[hub]) {
+                hub_weights_[entry.hub] = INFINITE_WEIGHT;
+            }
+        }
+
+        template <typename Weight>
+        typename HubLabels<Weight>::LabelSet HubLabelsBuilder<Weight>::Flatten(std::vector<std::vector<Entry>>& entries) {
+            typename Labels::LabelSet result;
+            result.offsets.reserve(entries.size() + 1);
+            result.offsets.push_back(0);
+            for (const std::vector<Entry>& vertex_entries : entries) {
+                result.offsets.push_back(result.offsets.back() + vertex_entries.size());
+            }
+            result.hubs.reserve(result.offsets.back());
+            result.weights.reserve(result.offsets.back());
+            result.edges.reserve(result.offsets.back());
+            for (std::vector<Entry>& vertex_entries : entries) {
+                for (const Entry& entry : vertex_entries) {
+                    result.hubs.push_back(entry.hub);
+                    result.weights.push_back(entry.weight);
+                    result.edges.push_back(entry.edge_id);
+                }
+                std::vector<Entry>().swap(vertex_entries);
+            }
+            return result;
+        }
+
+    }  // namespace detail
+
+    template <typename Weight>
+    HubLabels<Weight> BuildHubLabels(const DirectedWeightedGraph<Weight>& graph) {
+        return detail::HubLabelsBuilder<Weight>(graph).Build();
+    }
+
+    // Answers a query by merging the out labels of the source with the in labels of the
+    // target, then walks the entries of the best hub back to edge ids of the graph
+    template <typename Weight>
+    class HubLabelsRouter : public RouterBase<Weight> {
+    private:
+        using Labels = HubLabels<Weight>;
+
+    public:
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+
+        HubLabelsRouter(const DirectedWeightedGraph<Weight>& graph, std::shared_ptr<const Labels> labels);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    private:
+        // Position of the hub's entry among the entries of the vertex
+        static size_t FindEntry(const typename Labels::LabelSet& label_set, VertexId vertex, uint32_t hub);
+
+        const DirectedWeightedGraph<Weight>& graph_;
+        std::shared_ptr<const Labels> labels_;
+    };
+
+    template <typename Weight>
+    HubLabelsRouter<Weight>::HubLabelsRouter(const DirectedWeightedGraph<Weight>& graph, std::shared_ptr<const Labels> labels)
+        : graph_(graph)
+        , labels_(std::move(labels))
+    {
+        if (labels_->GetVertexCount() != graph_.GetVertexCount()) {
+            throw std::invalid_argument("Hub labels don't match the graph");
+        }
+    }
+
+    template <typename Weight>
+    size_t HubLabelsRouter<Weight>::FindEntry(const typename Labels::LabelSet& label_set, VertexId vertex, uint32_t hub) {
+        const auto begin = label_set.hubs.begin() + label_set.offsets[vertex];
+        const auto end = label_set.hubs.begin() + label_set.offsets[vertex + 1];
+        return std::lower_bound(begin, end, hub) - label_set.hubs.begin();
+    }
+
+    template <typename Weight>
+    std::optional<typename HubLabelsRouter<Weight>::RouteInfo> HubLabelsRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return RouteInfo{ Weight{}, {} };
+        }
+
+        const typename Labels::LabelSet& out_labels = labels_->out_labels;
+        const typename Labels::LabelSet& in_labels = labels_->in_labels;
+        std::optional<Weight> best_weight;
+        size_t best_out = 0;
+        size_t best_in = 0;
+        for (size_t out = out_labels.offsets[from], in = in_labels.offsets[to];
+            out < out_labels.offsets[from + 1] && in < in_labels.offsets[to + 1];) {
+            if (out_labels.hubs[out] < in_labels.hubs[in]) {
+                ++out;
+            }
+            else if (in_labels.hubs[in] < out_labels.hubs[out]) {
+                ++in;
+            }
+            else {
+                if (const Weight weight = out_labels.weights[out] + in_labels.weights[in]; !best_weight || weight < *best_weight) {
+                    best_weight = weight;
+                    best_out = out;
+                    best_in = in;
+                }
+                ++out;
+                ++in;
+            }
+        }
+        if (!best_weight) {
+            return std::nullopt;
+        }
+
+        const uint32_t hub = out_labels.hubs[best_out];
+        std::vector<EdgeId> edges;
+        for (size_t entry = best_out; out_labels.edges[entry] != Labels::NO_EDGE;) {
+            const EdgeId edge_id = out_labels.edges[entry];
+            edges.push_back(edge_id);
+            entry = FindEntry(out_labels, graph_.GetEdge(edge_id).to, hub);
+        }
+        const size_t out_edge_count = edges.size();
+        for (size_t entry = best_in; in_labels.edges[entry] != Labels::NO_EDGE;) {
+            const EdgeId edge_id = in_labels.edges[entry];
+            edges.push_back(edge_id);
+            entry = FindEntry(in_labels, graph_.GetEdge(edge_id).from, hub);
+        }
+        std::reverse(edges.begin() + out_edge_count, edges.end());
+        return RouteInfo{ *best_weight, std::move(edges) };
+    }
+
+}  // namespace graph
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "graph.h"
+
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Every vertex reachable from `from` within max_weight, with the weight of its
+    // shortest path, ordered by that weight. The search stops at the budget and keeps
+    // state only for the vertices it touches, so it costs as much as the explored
+    // region, not the whole graph.
+    template <typename Weight, typename EdgeWeigher>
+    std::vector<std::pair<VertexId, Weight>> BuildIsochrone(const DirectedWeightedGraph<Weight>& graph, VertexId from,
+        Weight max_weight, EdgeWeigher edge_weigher) {
+        if (from >= graph.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        std::unordered_map<VertexId, Weight> weights;
+        std::vector<std::pair<VertexId, Weight>> result;
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        weights.emplace(from, Weight{});
+        queue.push({ Weight{}, from });
+
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weights.at(vertex) < weight) {
+                continue;
+            }
+            result.emplace_back(vertex, weight);
+            graph.ForEachIncidentEdge(vertex, [&, weight = weight](EdgeId edge_id, VertexId to, const Weight& edge_weight) {
+                const Weight candidate_weight = weight + edge_weigher(edge_id, edge_weight);
+                if (max_weight < candidate_weight) {
+                    return;
+                }
+                const auto [it, inserted] = weights.emplace(to, candidate_weight);
+                if (inserted || candidate_weight < it->second) {
+                    it->second = candidate_weight;
+                    queue.push({ candidate_weight, to });
+                }
+            });
+        }
+        return result;
+    }
+
+    template <typename Weight>
+    std::vector<std::pair<VertexId, Weight>> BuildIsochrone(const DirectedWeightedGraph<Weight>& graph, VertexId from, Weight max_weight) {
+        return BuildIsochrone(graph, from, max_weight, [](EdgeId, const Weight& edge_weight) { return edge_weight; });
+    }
+
+}  // namespace graph
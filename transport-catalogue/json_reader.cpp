@@ -69,10 +69,27 @@ namespace transport_catalogue
                 }
             }
 
-            //Process stops
+            vector<ParsedStop> parsed_stops;
+            parsed_stops.reserve(stop_requests.size());
             for (const json::Node& request : stop_requests)
             {
-                ParsedStop parsed_stop = ParseStop(request);
+                parsed_stops.push_back(ParseStop(request));
+            }
+            vector<ParsedBus> parsed_buses;
+            parsed_buses.reserve(bus_requests.size());
+            for (const json::Node& request : bus_requests)
+            {
+                parsed_buses.push_back(ParseBus(request));
+            }
+            //Ids follow the order stops and buses are added in
+            if (transport_catalogue_.GetRouteSettings().stop_order == StopOrder::HILBERT)
+            {
+                OrderAlongHilbertCurve(parsed_stops, parsed_buses);
+            }
+
+            //Process stops
+            for (const ParsedStop& parsed_stop : parsed_stops)
+            {
                 transport_catalogue_.AddStop(parsed_stop.stop_name, {parsed_stop.latitude, parsed_stop.longitude});
             }
 
@@ -87,9 +104,8 @@ namespace transport_catalogue
             }
 
             //Process buses
-            for (const json::Node& request : bus_requests)
+            for (const ParsedBus& parsed_bus : parsed_buses)
             {
-                ParsedBus parsed_bus = ParseBus(request);
                 transport_catalogue_.AddBus(parsed_bus.bus_name, parsed_bus.stop_names, parsed_bus.is_looped);
             }
 
@@ -98,12 +114,74 @@ namespace transport_catalogue
             //router_.RouterAfterInitialization();
 		}
 
+        void JsonReader::OrderAlongHilbertCurve(vector<ParsedStop>& stops, vector<ParsedBus>& buses)
+        {
+            if (stops.empty())
+            {
+                return;
+            }
+            coordinates::Coordinates min{ stops.front().latitude, stops.front().longitude };
+            coordinates::Coordinates max = min;
+            for (const ParsedStop& stop : stops)
+            {
+                min = { std::min(min.lat, stop.latitude), std::min(min.lng, stop.longitude) };
+                max = { std::max(max.lat, stop.latitude), std::max(max.lng, stop.longitude) };
+            }
+            unordered_map<string, uint64_t> curve_indices;
+            for (const ParsedStop& stop : stops)
+            {
+                curve_indices[stop.stop_name] = coordinates::ComputeHilbertIndex({ stop.latitude, stop.longitude }, min, max);
+            }
+            //Stable, so that stops in the same cell and buses from the same stop keep the input order
+            stable_sort(stops.begin(), stops.end(), [&curve_indices](const ParsedStop& lhs, const ParsedStop& rhs)
+                {
+                    return curve_indices.at(lhs.stop_name) < curve_indices.at(rhs.stop_name);
+                });
+            const auto first_stop_index = [&curve_indices](const ParsedBus& bus)
+                {
+                    //Buses without stops or starting at a stop missing from the base go last
+                    if (bus.stop_names.empty())
+                    {
+                        return numeric_limits<uint64_t>::max();
+                    }
+                    const auto it = curve_indices.find(bus.stop_names.front());
+                    return it == curve_indices.end() ? numeric_limits<uint64_t>::max() : it->second;
+                };
+            stable_sort(buses.begin(), buses.end(), [&first_stop_index](const ParsedBus& lhs, const ParsedBus& rhs)
+                {
+                    return first_stop_index(lhs) < first_stop_index(rhs);
+                });
+        }
+
+        void JsonReader::ProcessBaseUpdates()
+        {
+            for (const json::Node& update : json_document_.GetRoot().AsMap().at("base_updates"s).AsArray())
+            {
+                const json::Dict& update_map = update.AsMap();
+                const string& update_type = update_map.at("type"s).AsString();
+                if (update_type == "Bus"s)
+                {
+                    ParsedBus parsed_bus = ParseBus(update);
+                    transport_catalogue_.UpdateBus(parsed_bus.bus_name, parsed_bus.stop_names, parsed_bus.is_looped);
+                }
+                else if (update_type == "RemoveBus"s)
+                {
+                    transport_catalogue_.RemoveBus(update_map.at("name"s).AsString());
+                }
+                else if (update_type == "Distance"s)
+                {
+                    transport_catalogue_.UpdateDistance(update_map.at("from"s).AsString(), update_map.at("to"s).AsString(), update_map.at("distance"s).AsInt());
+                }
+                else
+                {
+                    throw invalid_argument("Unknown base update type: "s + update_type);
+                }
+            }
+        }
+
         void JsonReader::ProscessRoutingSettings()
         {
-            json::Dict routing_settings_as_map = json_document_.GetRoot().AsMap().at("routing_settings"s).AsMap();
-            int bus_wait_time = routing_settings_as_map.at("bus_wait_time"s).AsInt();
-            double bus_velocity = routing_settings_as_map.at("bus_velocity"s).AsDouble(); 
-            transport_catalogue_.AddRouteSettings({bus_wait_time, bus_velocity});
+            transport_catalogue_.AddRouteSettings(GetRoutingSettings());
         }
 
         json::Dict JsonReader::ParseStopRequest(const json::Node& stop_node)
@@ -147,53 +225,110 @@ namespace transport_catalogue
             };
         }
 
-        json::Dict JsonReader::ParseRouteRequest(const json::Node& route_node, const graph::Router<double>& router)
+        json::Dict JsonReader::ParseRouteRequest(const json::Node& route_node, json::Dict route_response)
         {
-            int request_id = route_node.AsMap().at("id"s).AsInt();
-            std::string from_string = route_node.AsMap().at("from"s).AsString();
-            int from_int = transport_catalogue_.GetVertexId(from_string);
-            std::string to_string = route_node.AsMap().at("to"s).AsString();
-            int to_int = transport_catalogue_.GetVertexId(to_string);
+            route_response.emplace("request_id"s, route_node.AsMap().at("id"s).AsInt());
+            return route_response;
+        }
 
-            std::optional<graph::Router<double>::RouteInfo> route = router.BuildRoute(from_int, to_int);
+        json::Dict JsonReader::MakeRouteResponse(const std::optional<transport_router::RouteResult>& route, int bus_waiting_time)
+        {
             //check
             if (!route.has_value())
             {
-                return { {"request_id"s, request_id}, {"error_message"s, "not found"s}};
+                return { {"error_message"s, "not found"s} };
+            }
+            else if ((*route).items.empty())
+            {
+                return { {"total_time"s, 0}, {"items"s, json::Array(0)} };
             }
-            else if ((*route).edges.empty())
+
+            json::Builder builder{};
+            json::ArrayContext array_result = builder.StartDict().Key("total_time"s).Value((*route).total_time).Key("items"s).StartArray();
+
+            for (const transport_router::RouteItem& item : (*route).items)
             {
-                return { {"request_id"s, request_id}, {"total_time"s, 0}, {"items"s, json::Array(0)} };
+                array_result.StartDict().Key("type"s).Value("Wait"s).Key("stop_name"s).Value(std::string(item.stop_name)).Key("time"s).Value(bus_waiting_time).EndDict()
+                            .StartDict().Key("type"s).Value("Bus"s).Key("bus"s).Value(std::string(item.bus_name)).Key("span_count"s).Value(item.span_count).Key("time"s).Value(item.time).EndDict();
+            }
+            return array_result.EndArray().Build().AsMap();
+        }
+
+        json::Dict JsonReader::ParseReachableRequest(const json::Node& reachable_node, const RouteSettings& route_settings)
+        {
+            const json::Dict& request_map = reachable_node.AsMap();
+            int request_id = request_map.at("id"s).AsInt();
+            const std::optional<std::vector<transport_router::ReachableStop>> stops = transport_router::FindReachableStops(transport_catalogue_,
+                GetRequestRoutingSettings(request_map, route_settings), request_map.at("from"s).AsString(), request_map.at("max_time"s).AsDouble());
+            if (!stops.has_value())
+            {
+                return { {"request_id"s, request_id}, {"error_message"s, "not found"s} };
             }
 
             json::Builder builder{};
-            json::ArrayContext array_result = builder.StartDict().Key("request_id"s).Value(request_id).Key("total_time"s).Value((*route).weight).Key("items"s).StartArray();
-            int bus_waiting_time = transport_catalogue_.GetRouteSettings().bus_wait_time;
-            
-            std::string waiting_stop, bus_name;
-            double travel_time;
-            int span_count;
-
-            for (auto edge_id : (*route).edges)
-            {
-                waiting_stop = transport_catalogue_.GetFirstStopByEdgeId(edge_id);
-                bus_name = transport_catalogue_.GetBusNameByEdgeId(edge_id);
-                travel_time = transport_catalogue_.GetEdgeWeightByEdgeId(edge_id) - bus_waiting_time;
-                span_count = transport_catalogue_.GetSpanCountByEdgeId(edge_id);
-                array_result.StartDict().Key("type"s).Value("Wait"s).Key("stop_name"s).Value(waiting_stop).Key("time"s).Value(bus_waiting_time).EndDict()
-                            .StartDict().Key("type"s).Value("Bus"s).Key("bus"s).Value(std::string(bus_name)).Key("span_count"s).Value(span_count).Key("time"s).Value(travel_time).EndDict();
+            json::ArrayContext array_result = builder.StartDict().Key("request_id"s).Value(request_id).Key("items"s).StartArray();
+            for (const transport_router::ReachableStop& stop : *stops)
+            {
+                array_result.StartDict().Key("stop_name"s).Value(std::string(stop.stop_name)).Key("time"s).Value(stop.time).EndDict();
             }
             return array_result.EndArray().Build().AsMap();
         }
 
+        json::Dict JsonReader::ParseMatrixRequest(const json::Node& matrix_node, const RouteSettings& route_settings)
+        {
+            const json::Dict& request_map = matrix_node.AsMap();
+            int request_id = request_map.at("id"s).AsInt();
+            std::vector<std::string_view> origins;
+            std::vector<std::string_view> destinations;
+            for (const auto& [key, stop_names] : { std::pair{ "origins"s, &origins }, std::pair{ "destinations"s, &destinations } })
+            {
+                for (const json::Node& stop_name : request_map.at(key).AsArray())
+                {
+                    if (transport_catalogue_.GetVertexId(stop_name.AsString()) >= transport_catalogue_.GetStops().size())
+                    {
+                        return { {"request_id"s, request_id}, {"error_message"s, "not found"s} };
+                    }
+                    stop_names->push_back(stop_name.AsString());
+                }
+            }
+
+            const RouteSettings request_settings = GetRequestRoutingSettings(request_map, route_settings);
+            const std::vector<std::optional<double>> times = GetTransportRouter(request_settings).BuildTimeMatrix(origins, destinations, request_settings.router_threads);
+            json::Array times_array;
+            times_array.reserve(times.size());
+            for (const std::optional<double>& time : times)
+            {
+                times_array.push_back(time ? json::Node(*time) : json::Node(nullptr));
+            }
+            return { {"request_id"s, request_id}, {"times"s, std::move(times_array)} };
+        }
+
+        RouteSettings JsonReader::GetRequestRoutingSettings(const json::Dict& request_map, const RouteSettings& route_settings)
+        {
+            RouteSettings result = route_settings;
+            if (request_map.count("bus_wait_time"s))
+            {
+                result.bus_wait_time = request_map.at("bus_wait_time"s).AsInt();
+            }
+            if (request_map.count("bus_velocity"s))
+            {
+                result.bus_velocity = request_map.at("bus_velocity"s).AsDouble();
+            }
+            return result;
+        }
+
         void JsonReader::ProcessStatRequests(std::ostream& output)
         {
             json::Array requests_array = json_document_.GetRoot().AsMap().at("stat_requests"s).AsArray();
             //json::Array result;
             json::Builder builder;
             json::ArrayContext array_result = builder.StartArray();
-            const graph::DirectedWeightedGraph<double>& graph = transport_catalogue_.GetGraph();
-            graph::Router router(graph);
+            //Routers and cached answers of an earlier document may predate updates of the catalogue
+            transport_routers_.clear();
+            route_cache_.reset();
+            const RouteSettings route_settings = GetStatRoutingSettings();
+            std::vector<json::Dict> routes = BuildRoutes(requests_array, route_settings);
+            size_t request_index = 0;
 
             for (const json::Node& request : requests_array)
             {
@@ -217,12 +352,158 @@ namespace transport_catalogue
                 }
                 else if (request.AsMap().at("type"s).AsString() == "Route"s)
                 {
-                    array_result.Value(ParseRouteRequest(request, router));
+                    array_result.Value(ParseRouteRequest(request, std::move(routes[request_index])));
                 }
+                else if (request.AsMap().at("type"s).AsString() == "Matrix"s)
+                {
+                    array_result.Value(ParseMatrixRequest(request, route_settings));
+                }
+                else if (request.AsMap().at("type"s).AsString() == "Reachable"s)
+                {
+                    array_result.Value(ParseReachableRequest(request, route_settings));
+                }
+                ++request_index;
             }
             json::Builder result = array_result.EndArray();
             //json_result_ = json::Document(result.Build());
             json::Print(json::Document(result.Build()), output);
+            if (route_cache_)
+            {
+                const cache::CacheStats stats = route_cache_->GetStats();
+                std::clog << "route_cache: "sv << stats.hits << " hits, "sv << stats.misses << " misses, "sv << stats.evictions << " evictions, "sv
+                    << stats.entries << " entries in "sv << stats.memory_used << " bytes"sv << std::endl;
+            }
+        }
+
+        namespace
+        {
+            //Rough heap footprint of a node: the cache budget is spent on what answers really take
+            size_t EstimateNodeSize(const json::Node& node)
+            {
+                size_t result = sizeof(json::Node);
+                if (node.IsString())
+                {
+                    result += node.AsString().capacity();
+                }
+                else if (node.IsArray())
+                {
+                    for (const json::Node& element : node.AsArray())
+                    {
+                        result += EstimateNodeSize(element);
+                    }
+                }
+                else if (node.IsMap())
+                {
+                    for (const auto& [key, value] : node.AsMap())
+                    {
+                        //Tree node links and colour next to every key
+                        result += 4 * sizeof(void*) + sizeof(std::string) + key.capacity() + EstimateNodeSize(value);
+                    }
+                }
+                return result;
+            }
+
+            size_t EstimateRouteCacheCharge(const RouteCacheKey& key, const json::Dict& route_response)
+            {
+                //Key, list and index entries of the cache itself
+                size_t result = 2 * sizeof(RouteCacheKey) + key.from.capacity() + key.to.capacity() + 8 * sizeof(void*);
+                for (const auto& [name, value] : route_response)
+                {
+                    result += 4 * sizeof(void*) + sizeof(std::string) + name.capacity() + EstimateNodeSize(value);
+                }
+                return result;
+            }
+        }
+
+        std::vector<json::Dict> JsonReader::BuildRoutes(const json::Array& requests, const RouteSettings& route_settings)
+        {
+            if (!route_cache_ && route_settings.route_cache_budget != 0)
+            {
+                route_cache_ = std::make_unique<RouteCache>(route_settings.route_cache_budget, route_settings.route_cache_shards, EstimateRouteCacheCharge);
+            }
+
+            //Requests are batched per router: the stat settings, or the wait time and velocity of a request
+            struct RouteBatch
+            {
+                RouteSettings settings;
+                std::vector<size_t> request_indices;
+                std::vector<RouteCacheKey> keys;
+                std::vector<std::pair<std::string_view, std::string_view>> queries;
+            };
+            std::map<std::pair<int, double>, RouteBatch> batches;
+            std::vector<json::Dict> routes(requests.size());
+            //Repeated requests wait for the first one with the same key instead of being routed again
+            std::unordered_map<RouteCacheKey, size_t, RouteCacheKeyHasher> pending_requests;
+            std::vector<std::pair<size_t, size_t>> repeated_requests;
+            for (size_t i = 0; i != requests.size(); ++i)
+            {
+                const json::Dict& request_map = requests[i].AsMap();
+                if (request_map.at("type"s).AsString() != "Route"s)
+                {
+                    continue;
+                }
+                const RouteSettings request_settings = GetRequestRoutingSettings(request_map, route_settings);
+                RouteCacheKey key
+                {
+                    request_map.at("from"s).AsString(), request_map.at("to"s).AsString(), request_settings.bus_wait_time,
+                    request_settings.bus_velocity, request_settings.router_engine, request_settings.raptor_max_rounds
+                };
+                if (const auto pending = pending_requests.find(key); pending != pending_requests.end())
+                {
+                    repeated_requests.emplace_back(i, pending->second);
+                    continue;
+                }
+                if (route_cache_)
+                {
+                    if (std::optional<json::Dict> cached = route_cache_->Get(key))
+                    {
+                        routes[i] = std::move(*cached);
+                        continue;
+                    }
+                }
+                pending_requests.emplace(key, i);
+                RouteBatch& batch = batches[{ request_settings.bus_wait_time, request_settings.bus_velocity }];
+                batch.settings = request_settings;
+                batch.request_indices.push_back(i);
+                batch.queries.emplace_back(request_map.at("from"s).AsString(), request_map.at("to"s).AsString());
+                batch.keys.push_back(std::move(key));
+            }
+
+            //Routers are built only for the batches there are: Stop/Bus/Map-only files don't pay for them
+            for (auto& [settings_key, batch] : batches)
+            {
+                const transport_router::TransportRouter& router = GetTransportRouter(batch.settings);
+                const std::vector<std::optional<transport_router::RouteResult>> batch_routes = router.BuildRoutes(batch.queries, batch.settings.router_threads);
+                parallel::ForEachIndex(batch_routes.size(), parallel::ResolveThreadCount(batch.settings.router_threads), [&](size_t i)
+                    {
+                        json::Dict& route_response = routes[batch.request_indices[i]];
+                        route_response = MakeRouteResponse(batch_routes[i], batch.settings.bus_wait_time);
+                        if (route_cache_)
+                        {
+                            route_cache_->Put(batch.keys[i], route_response);
+                        }
+                    });
+            }
+            for (const auto& [request_index, first_index] : repeated_requests)
+            {
+                routes[request_index] = routes[first_index];
+            }
+            return routes;
+        }
+
+        const transport_router::TransportRouter& JsonReader::GetTransportRouter(const RouteSettings& route_settings)
+        {
+            std::unique_ptr<transport_router::TransportRouter>& router = transport_routers_[{ route_settings.bus_wait_time, route_settings.bus_velocity }];
+            if (!router)
+            {
+                router = std::make_unique<transport_router::TransportRouter>(transport_catalogue_, route_settings);
+            }
+            return *router;
+        }
+
+        cache::CacheStats JsonReader::GetRouteCacheStats() const
+        {
+            return route_cache_ ? route_cache_->GetStats() : cache::CacheStats{};
         }
 
         /*void JsonReader::PrintResult()
@@ -335,9 +616,74 @@ namespace transport_catalogue
         RouteSettings JsonReader::GetRoutingSettings() const 
         {
             json::Dict routing_settings_map = json_document_.GetRoot().AsMap().at("routing_settings"s).AsMap();
-            int bus_wait_time = routing_settings_map.at("bus_wait_time"s).AsInt();
-            double bus_velocity = routing_settings_map.at("bus_velocity"s).AsDouble();
-            return { bus_wait_time, bus_velocity };
+            RouteSettings result;
+            result.bus_wait_time = routing_settings_map.at("bus_wait_time"s).AsInt();
+            result.bus_velocity = routing_settings_map.at("bus_velocity"s).AsDouble();
+            if (routing_settings_map.count("graph_model"s))
+            {
+                result.graph_model = transport_router::ParseGraphModel(routing_settings_map.at("graph_model"s).AsString());
+            }
+            if (routing_settings_map.count("compact_graph"s))
+            {
+                result.compact_graph = routing_settings_map.at("compact_graph"s).AsBool();
+            }
+            if (routing_settings_map.count("stop_order"s))
+            {
+                result.stop_order = transport_router::ParseStopOrder(routing_settings_map.at("stop_order"s).AsString());
+            }
+            if (routing_settings_map.count("graph_threads"s))
+            {
+                result.graph_threads = routing_settings_map.at("graph_threads"s).AsInt();
+            }
+            ParseRouterOptions(routing_settings_map, result);
+            return result;
+        }
+
+        RouteSettings JsonReader::GetStatRoutingSettings() const
+        {
+            RouteSettings result = transport_catalogue_.GetRouteSettings();
+            const json::Dict& root = json_document_.GetRoot().AsMap();
+            if (root.count("routing_settings"s))
+            {
+                ParseRouterOptions(root.at("routing_settings"s).AsMap(), result);
+            }
+            return result;
+        }
+
+        void JsonReader::ParseRouterOptions(const json::Dict& routing_settings_map, RouteSettings& route_settings)
+        {
+            if (routing_settings_map.count("router_engine"s))
+            {
+                route_settings.router_engine = transport_router::ParseRouterEngine(routing_settings_map.at("router_engine"s).AsString());
+            }
+            if (routing_settings_map.count("precompute_routes"s))
+            {
+                route_settings.precompute_routes = routing_settings_map.at("precompute_routes"s).AsBool();
+            }
+            if (routing_settings_map.count("router_threads"s))
+            {
+                route_settings.router_threads = routing_settings_map.at("router_threads"s).AsInt();
+            }
+            if (routing_settings_map.count("raptor_max_rounds"s))
+            {
+                route_settings.raptor_max_rounds = routing_settings_map.at("raptor_max_rounds"s).AsInt();
+            }
+            if (routing_settings_map.count("router_memory_budget"s))
+            {
+                route_settings.router_memory_budget = routing_settings_map.at("router_memory_budget"s).AsDouble();
+            }
+            if (routing_settings_map.count("router_weights"s))
+            {
+                route_settings.router_weights = transport_router::ParseRouterWeights(routing_settings_map.at("router_weights"s).AsString());
+            }
+            if (routing_settings_map.count("route_cache_budget"s))
+            {
+                route_settings.route_cache_budget = routing_settings_map.at("route_cache_budget"s).AsInt();
+            }
+            if (routing_settings_map.count("route_cache_shards"s))
+            {
+                route_settings.route_cache_shards = routing_settings_map.at("route_cache_shards"s).AsInt();
+            }
         }
 
         std::string JsonReader::GetSerializationFilename() const 
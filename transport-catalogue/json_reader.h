@@ -6,14 +6,56 @@
 #include "json.h"
 #include "map_renderer.h"
 #include "json_builder.h"
+#include "transport_router.h"
+#include "lru_cache.h"
+#include "parallel.h"
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <sstream>
+#include <stdexcept>
 namespace transport_catalogue
 {
 	namespace json_reader
 	{
+		//Route requests with equal stops and router settings get equal answers
+		struct RouteCacheKey
+		{
+			std::string from;
+			std::string to;
+			int bus_wait_time;
+			double bus_velocity;
+			RouterEngine router_engine;
+			size_t raptor_max_rounds;
+
+			bool operator==(const RouteCacheKey& other) const
+			{
+				return from == other.from && to == other.to && bus_wait_time == other.bus_wait_time && bus_velocity == other.bus_velocity
+					&& router_engine == other.router_engine && raptor_max_rounds == other.raptor_max_rounds;
+			}
+		};
+
+		struct RouteCacheKeyHasher
+		{
+			size_t operator() (const RouteCacheKey& key) const
+			{
+				return (string_hasher(key.from) * 37 + string_hasher(key.to)) * 37 + std::hash<double>{}(key.bus_velocity) * 17 + key.bus_wait_time;
+			}
+
+		private:
+			std::hash<std::string> string_hasher;
+		};
+
+		//Answers of Route requests without their request_id
+		using RouteCache = cache::ShardedLruCache<RouteCacheKey, json::Dict, RouteCacheKeyHasher>;
+
 		class JsonReader
 		{
 		public:
@@ -21,6 +63,9 @@ namespace transport_catalogue
 
 			void							LoadJSON(std::istream& input);
 			void							ProcessBaseRequests();
+			//"base_updates" of an update_base document: "Bus" adds or replaces a bus,
+			//"RemoveBus" removes one, "Distance" sets the road distance between two stops
+			void							ProcessBaseUpdates();
 			void							ProscessRoutingSettings();
 			void							ProcessStatRequests(std::ostream& output);
 			//void							PrintResult();
@@ -28,18 +73,42 @@ namespace transport_catalogue
 			ParsedStop						ParseStop(const json::Node& stop_node);
 			ParsedDistance					ParseDistance(const json::Node& stop_node);
 			ParsedBus						ParseBus(const json::Node& bus_node);
+			//Sorts the stops along a Hilbert curve over their coordinates and the buses by their first stops
+			static void						OrderAlongHilbertCurve(std::vector<ParsedStop>& stops, std::vector<ParsedBus>& buses);
 
 			json::Dict						ParseStopRequest(const json::Node& stop_node);
 			json::Dict						ParseBusRequest(const json::Node& bus_node);
-			json::Dict						ParseRouteRequest(const json::Node& route_node, const graph::Router<double>& router);
+			json::Dict						ParseRouteRequest(const json::Node& route_node, json::Dict route_response);
+			static json::Dict				MakeRouteResponse(const std::optional<transport_router::RouteResult>& route, int bus_waiting_time);
+			//Answers all Route requests up front, indexed like the requests; the others are left empty.
+			//Answers found in the route cache aren't built again
+			std::vector<json::Dict>			BuildRoutes(const json::Array& requests, const RouteSettings& route_settings);
+			//Stops reachable from "from" within "max_time" minutes, with the time each one takes
+			json::Dict						ParseReachableRequest(const json::Node& reachable_node, const RouteSettings& route_settings);
+			//Travel times from every stop of "origins" to every stop of "destinations", row-major, null where there is no route
+			json::Dict						ParseMatrixRequest(const json::Node& matrix_node, const RouteSettings& route_settings);
+			//Hits, misses and evictions of the route cache, all zero while it isn't created
+			cache::CacheStats				GetRouteCacheStats() const;
 
 			map_renderer::RenderSettings	GetRenderSettings() const;
 			RouteSettings					GetRoutingSettings() const;
+			//Settings stored in the base with router options of the stat document applied on top
+			RouteSettings					GetStatRoutingSettings() const;
+			//Route settings with the "bus_wait_time" and "bus_velocity" of a request applied on top
+			static RouteSettings			GetRequestRoutingSettings(const json::Dict& request_map, const RouteSettings& route_settings);
+			//Optional keys of "routing_settings" that tune the router rather than the graph
+			static void						ParseRouterOptions(const json::Dict& routing_settings_map, RouteSettings& route_settings);
 			std::string						GetSerializationFilename() const;
 		private:
+			//One router per wait time and velocity, shared by the requests of a stat document
+			const transport_router::TransportRouter& GetTransportRouter(const RouteSettings& route_settings);
+
 			TransportCatalogue&				transport_catalogue_;
 			json::Document					json_document_;
 			json::Document					json_result_;
+			//Created by the first Route requests of a stat document, dropped with the routers
+			std::unique_ptr<RouteCache>		route_cache_;
+			std::map<std::pair<int, double>, std::unique_ptr<transport_router::TransportRouter>> transport_routers_;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cache {
+
+    struct CacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t memory_used = 0;
+    };
+
+    // LRU cache bounded by the memory its entries are charged for. Keys are spread
+    // over independently locked shards, each owning an equal part of the budget,
+    // so threads working on different keys rarely wait for each other.
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class ShardedLruCache {
+    public:
+        // Estimated memory an entry takes, the cache itself doesn't know how values are laid out
+        using ChargeFunction = std::function<size_t(const Key&, const Value&)>;
+
+        ShardedLruCache(size_t memory_budget, size_t shard_count, ChargeFunction charge);
+
+        std::optional<Value> Get(const Key& key);
+        // An entry charged for more than a shard's budget is not stored
+        void Put(const Key& key, Value value);
+        CacheStats GetStats() const;
+
+    private:
+        struct Shard {
+            using Entries = std::list<std::pair<Key, Value>>;
+
+            mutable std::mutex mutex;
+            // Most recently used first
+            Entries entries;
+            std::unordered_map<Key, typename Entries::iterator, Hash> index;
+            std::unordered_map<Key, size_t, Hash> charges;
+            CacheStats stats;
+        };
+
+        Shard& GetShard(const Key& key);
+        void Evict(Shard& shard, typename Shard::Entries::iterator it);
+
+        size_t shard_budget_;
+        ChargeFunction charge_;
+        Hash hash_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+    };
+
+    template <typename Key, typename Value, typename Hash>
+    ShardedLruCache<Key, Value, Hash>::ShardedLruCache(size_t memory_budget, size_t shard_count, ChargeFunction charge)
+        : shard_budget_(memory_budget / std::max<size_t>(1, shard_count))
+        , charge_(std::move(charge))
+    {
+        shards_.reserve(std::max<size_t>(1, shard_count));
+        for (size_t i = 0; i < std::max<size_t>(1, shard_count); ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    template <typename Key, typename Value, typename Hash>
+    typename ShardedLruCache<Key, Value, Hash>::Shard& ShardedLruCache<Key, Value, Hash>::GetShard(const Key& key) {
+        return *shards_[hash_(key) % shards_.size()];
+    }
+
+    template <typename Key, typename Value, typename Hash>
+    std::optional<Value> ShardedLruCache<Key, Value, Hash>::Get(const Key& key) {
+        Shard& shard = GetShard(key);
+        std::lock_guard guard(shard.mutex);
+        const auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            ++shard.stats.misses;
+            return std::nullopt;
+        }
+        ++shard.stats.hits;
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return it->second->second;
+    }
+
+    template <typename Key, typename Value, typename Hash>
+    void ShardedLruCache<Key, Value, Hash>::Put(const Key& key, Value value) {
+        const size_t charge = charge_(key, value);
+        if (charge > shard_budget_) {
+            return;
+        }
+        Shard& shard = GetShard(key);
+        std::lock_guard guard(shard.mutex);
+        if (const auto it = shard.index.find(key); it != shard.index.end()) {
+            Evict(shard, it->second);
+            --shard.stats.evictions;
+        }
+        while (shard.stats.memory_used + charge > shard_budget_) {
+            Evict(shard, std::prev(shard.entries.end()));
+        }
+        shard.entries.emplace_front(key, std::move(value));
+        shard.index.emplace(key, shard.entries.begin());
+        shard.charges.emplace(key, charge);
+        shard.stats.memory_used += charge;
+        ++shard.stats.entries;
+    }
+
+    template <typename Key, typename Value, typename Hash>
+    void ShardedLruCache<Key, Value, Hash>::Evict(Shard& shard, typename Shard::Entries::iterator it) {
+        const auto charge_it = shard.charges.find(it->first);
+        shard.stats.memory_used -= charge_it->second;
+        shard.charges.erase(charge_it);
+        shard.index.erase(it->first);
+        shard.entries.erase(it);
+        --shard.stats.entries;
+        ++shard.stats.evictions;
+    }
+
+    template <typename Key, typename Value, typename Hash>
+    CacheStats ShardedLruCache<Key, Value, Hash>::GetStats() const {
+        CacheStats result;
+        for (const auto& shard : shards_) {
+            std::lock_guard guard(shard->mutex);
+            result.hits += shard->stats.hits;
+            result.misses += shard->stats.misses;
+            result.evictions += shard->stats.evictions;
+            result.entries += shard->stats.entries;
+            result.memory_used += shard->stats.memory_used;
+        }
+        return result;
+    }
+
+}  // namespace cache
@@ -53,5 +53,16 @@ int main(int argc, const char** argv)
 
 		request_handler.ProcessRequests(output_txt);
 	}
+	else if (argv[1] == "update_base"s) 
+	{
+		transport_catalogue::TransportCatalogue catalogue;
+		request_handler::RequestHandler request_handler(catalogue);
+		request_handler.LoadJsonDocument(base_input);
+
+		std::string filename = request_handler.GetSerializationFilename();
+		Deserialize(filename, catalogue);
+		request_handler.UpdateData();
+		Serialize(catalogue, filename);
+	}
 	return 0;
 }
\ No newline at end of file
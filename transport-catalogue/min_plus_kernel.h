@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GRAPH_MIN_PLUS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace graph {
+    namespace min_plus {
+
+        using PackedEdgeId = uint32_t;
+
+        // One min-plus pass over a table row: row[j] = min(row[j], weight_from + through[j]).
+        // An improved cell takes the last edge of the "through" route, or prev_edge_from
+        // when the route ends right at the through vertex.
+        template <typename Weight>
+        void RelaxRowScalar(Weight* weights, PackedEdgeId* prev_edges,
+                            const Weight* through_weights, const PackedEdgeId* through_prev_edges,
+                            size_t count, Weight weight_from, PackedEdgeId prev_edge_from) {
+            constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+            constexpr PackedEdgeId NO_EDGE = std::numeric_limits<PackedEdgeId>::max();
+            for (size_t i = 0; i < count; ++i) {
+                const Weight weight_to = through_weights[i];
+                if (weight_to == INFINITE_WEIGHT) {
+                    continue;
+                }
+                const Weight candidate_weight = weight_from + weight_to;
+                if (candidate_weight < weights[i]) {
+                    weights[i] = candidate_weight;
+                    prev_edges[i] = through_prev_edges[i] != NO_EDGE ? through_prev_edges[i] : prev_edge_from;
+                }
+            }
+        }
+
+#ifdef GRAPH_MIN_PLUS_AVX2
+        // Compares four cells per instruction; late in the relaxation almost no cell
+        // improves, so the rare hits are written back by the scalar code of the same lanes
+        __attribute__((target("avx2")))
+        inline void RelaxRowAvx2(double* weights, PackedEdgeId* prev_edges,
+                                 const double* through_weights, const PackedEdgeId* through_prev_edges,
+                                 size_t count, double weight_from, PackedEdgeId prev_edge_from) {
+            constexpr size_t LANES = 4;
+            const __m256d from = _mm256_set1_pd(weight_from);
+            const __m256d infinity = _mm256_set1_pd(std::numeric_limits<double>::max());
+            size_t i = 0;
+            for (; i + LANES <= count; i += LANES) {
+                const __m256d weight_to = _mm256_loadu_pd(through_weights + i);
+                const __m256d candidate = _mm256_add_pd(from, weight_to);
+                const __m256d improved = _mm256_and_pd(
+                    _mm256_cmp_pd(candidate, _mm256_loadu_pd(weights + i), _CMP_LT_OQ),
+                    _mm256_cmp_pd(weight_to, infinity, _CMP_NEQ_OQ));
+                if (_mm256_movemask_pd(improved) != 0) {
+                    RelaxRowScalar(weights + i, prev_edges + i, through_weights + i, through_prev_edges + i,
+                                   LANES, weight_from, prev_edge_from);
+                }
+            }
+            RelaxRowScalar(weights + i, prev_edges + i, through_weights + i, through_prev_edges + i,
+                           count - i, weight_from, prev_edge_from);
+        }
+
+        // Same for float weights, eight cells per instruction
+        __attribute__((target("avx2")))
+        inline void RelaxRowAvx2(float* weights, PackedEdgeId* prev_edges,
+                                 const float* through_weights, const PackedEdgeId* through_prev_edges,
+                                 size_t count, float weight_from, PackedEdgeId prev_edge_from) {
+            constexpr size_t LANES = 8;
+            const __m256 from = _mm256_set1_ps(weight_from);
+            const __m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::max());
+            size_t i = 0;
+            for (; i + LANES <= count; i += LANES) {
+                const __m256 weight_to = _mm256_loadu_ps(through_weights + i);
+                const __m256 candidate = _mm256_add_ps(from, weight_to);
+                const __m256 improved = _mm256_and_ps(
+                    _mm256_cmp_ps(candidate, _mm256_loadu_ps(weights + i), _CMP_LT_OQ),
+                    _mm256_cmp_ps(weight_to, infinity, _CMP_NEQ_OQ));
+                if (_mm256_movemask_ps(improved) != 0) {
+                    RelaxRowScalar(weights + i, prev_edges + i, through_weights + i, through_prev_edges + i,
+                                   LANES, weight_from, prev_edge_from);
+                }
+            }
+            RelaxRowScalar(weights + i, prev_edges + i, through_weights + i, through_prev_edges + i,
+                           count - i, weight_from, prev_edge_from);
+        }
+
+        inline bool HasAvx2() {
+            static const bool has_avx2 = __builtin_cpu_supports("avx2");
+            return has_avx2;
+        }
+#endif
+
+        template <typename Weight>
+        void RelaxRow(Weight* weights, PackedEdgeId* prev_edges,
+                      const Weight* through_weights, const PackedEdgeId* through_prev_edges,
+                      size_t count, Weight weight_from, PackedEdgeId prev_edge_from) {
+            RelaxRowScalar(weights, prev_edges, through_weights, through_prev_edges, count, weight_from, prev_edge_from);
+        }
+
+#ifdef GRAPH_MIN_PLUS_AVX2
+        template <>
+        inline void RelaxRow<double>(double* weights, PackedEdgeId* prev_edges,
+                                     const double* through_weights, const PackedEdgeId* through_prev_edges,
+                                     size_t count, double weight_from, PackedEdgeId prev_edge_from) {
+            if (HasAvx2()) {
+                RelaxRowAvx2(weights, prev_edges, through_weights, through_prev_edges, count, weight_from, prev_edge_from);
+            }
+            else {
+                RelaxRowScalar(weights, prev_edges, through_weights, through_prev_edges, count, weight_from, prev_edge_from);
+            }
+        }
+
+        template <>
+        inline void RelaxRow<float>(float* weights, PackedEdgeId* prev_edges,
+                                    const float* through_weights, const PackedEdgeId* through_prev_edges,
+                                    size_t count, float weight_from, PackedEdgeId prev_edge_from) {
+            if (HasAvx2()) {
+                RelaxRowAvx2(weights, prev_edges, through_weights, through_prev_edges, count, weight_from, prev_edge_from);
+            }
+            else {
+                RelaxRowScalar(weights, prev_edges, through_weights, through_prev_edges, count, weight_from, prev_edge_from);
+            }
+        }
+#endif
+
+    }  // namespace min_plus
+}  // namespace graph
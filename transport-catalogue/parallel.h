@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    // 0 means "as many threads as the hardware offers"
+    inline size_t ResolveThreadCount(size_t requested) {
+        if (requested != 0) {
+            return requested;
+        }
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Reusable barrier for a fixed group of threads (std::barrier needs C++20)
+    class Barrier {
+    public:
+        explicit Barrier(size_t thread_count)
+            : thread_count_(thread_count) {
+        }
+
+        void ArriveAndWait() {
+            std::unique_lock lock(mutex_);
+            const size_t generation = generation_;
+            if (++arrived_ == thread_count_) {
+                arrived_ = 0;
+                ++generation_;
+                condition_.notify_all();
+                return;
+            }
+            condition_.wait(lock, [this, generation] { return generation != generation_; });
+        }
+
+    private:
+        const size_t thread_count_;
+        size_t arrived_ = 0;
+        size_t generation_ = 0;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+    };
+
+    // Runs func(thread_index) on thread_count threads (the calling one included)
+    // and rethrows the first exception thrown by any of them
+    template <typename Func>
+    void RunThreads(size_t thread_count, Func func) {
+        if (thread_count <= 1) {
+            func(size_t{ 0 });
+            return;
+        }
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto guarded = [&](size_t thread_index) {
+            try {
+                func(thread_index);
+            }
+            catch (...) {
+                std::lock_guard guard(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+            threads.emplace_back(guarded, thread_index);
+        }
+        guarded(0);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Calls func(index) for every index in [0, count), handing indices out dynamically
+    template <typename Func>
+    void ForEachIndex(size_t count, size_t thread_count, Func func) {
+        std::atomic<size_t> next_index = 0;
+        RunThreads(std::min(thread_count, count), [&](size_t) {
+            for (size_t index = next_index++; index < count; index = next_index++) {
+                func(index);
+            }
+        });
+    }
+
+}  // namespace parallel
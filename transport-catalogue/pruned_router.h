@@ -0,0 +1,263 @@
+#pragma once
+
+#include "graph.h"
+#include "router_base.h"
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Strongly connected components over the edges that aren't removed, found by an iterative
+    // Tarjan's algorithm. Components are numbered in reverse topological order of the
+    // condensation: no edge leads to a component with a greater id, so a vertex can't reach
+    // any vertex whose component id is greater than its own.
+    template <typename Weight>
+    std::vector<uint32_t> FindStronglyConnectedComponents(const DirectedWeightedGraph<Weight>& graph) {
+        using EdgeIterator = decltype(graph.GetIncidentEdges(0).begin());
+        constexpr uint32_t UNVISITED = std::numeric_limits<uint32_t>::max();
+
+        const size_t vertex_count = graph.GetVertexCount();
+        std::vector<uint32_t> component_ids(vertex_count, UNVISITED);
+        std::vector<uint32_t> indices(vertex_count, UNVISITED);
+        std::vector<uint32_t> low_links(vertex_count);
+        std::vector<bool> on_stack(vertex_count, false);
+        std::vector<VertexId> stack;
+        // Vertex and the part of its incident edges not walked yet
+        std::vector<std::tuple<VertexId, EdgeIterator, EdgeIterator>> path;
+        uint32_t next_index = 0;
+        uint32_t next_component_id = 0;
+
+        const auto visit = [&](VertexId vertex) {
+            indices[vertex] = low_links[vertex] = next_index++;
+            stack.push_back(vertex);
+            on_stack[vertex] = true;
+            const auto incident_edges = graph.GetIncidentEdges(vertex);
+            path.emplace_back(vertex, incident_edges.begin(), incident_edges.end());
+        };
+
+        for (VertexId root = 0; root < vertex_count; ++root) {
+            if (indices[root] != UNVISITED) {
+                continue;
+            }
+            visit(root);
+            while (!path.empty()) {
+                auto& [vertex, edge_it, edge_end] = path.back();
+                if (edge_it != edge_end) {
+                    const VertexId to = graph.GetEdge(*edge_it++).to;
+                    if (indices[to] == UNVISITED) {
+                        visit(to);
+                    }
+                    else if (on_stack[to] && indices[to] < low_links[vertex]) {
+                        low_links[vertex] = indices[to];
+                    }
+                    continue;
+                }
+                const VertexId done_vertex = vertex;
+                path.pop_back();
+                if (!path.empty()) {
+                    const VertexId parent = std::get<0>(path.back());
+                    if (low_links[done_vertex] < low_links[parent]) {
+                        low_links[parent] = low_links[done_vertex];
+                    }
+                }
+                if (low_links[done_vertex] == indices[done_vertex]) {
+                    VertexId member;
+                    do {
+                        member = stack.back();
+                        stack.pop_back();
+                        on_stack[member] = false;
+                        component_ids[member] = next_component_id;
+                    } while (member != done_vertex);
+                    ++next_component_id;
+                }
+            }
+        }
+        return component_ids;
+    }
+
+    // Routes over a copy of the graph compacted to its routable vertices, those with at least
+    // one edge: stops no bus visits and vertices left without edges get neither rows in the
+    // routes table nor slots in the search arrays. Queries the strongly connected components
+    // prove unreachable, isolated vertices included, are answered in O(1) without a search.
+    // Routes come back with the edge ids of the original graph.
+    // The copy may keep its weights in a narrower CompactWeight (float for double weights),
+    // halving the tables of the engine. The engine then picks the route by the rounded weights,
+    // and its weight is summed anew from the full-precision weights of the route's edges.
+    template <typename Weight, typename CompactWeight = Weight>
+    class PrunedRouter : public RouterBase<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+        using CompactGraph = DirectedWeightedGraph<CompactWeight>;
+        using CompactRouteInfo = typename RouterBase<CompactWeight>::RouteInfo;
+
+    public:
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+        using EdgeWeigher = std::function<Weight(const Edge<Weight>&)>;
+        using RouterFactory = std::function<std::unique_ptr<RouterBase<CompactWeight>>(const CompactGraph&)>;
+
+        // make_router builds the engine over the compacted graph; with an edge weigher the
+        // copied edges are weighed by it instead of keeping the stored weights
+        PrunedRouter(const Graph& graph, const RouterFactory& make_router, const EdgeWeigher& edge_weigher = {});
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const override;
+
+        size_t GetRoutableVertexCount() const;
+
+    private:
+        static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+        static constexpr bool NARROWED = !std::is_same_v<Weight, CompactWeight>;
+
+        // Takes compacted ids, NO_VERTEX stands for an unroutable vertex
+        bool IsUnreachable(VertexId from, VertexId to) const;
+        VertexId GetCompactVertexId(VertexId vertex) const;
+        std::optional<RouteInfo> RestoreRoute(std::optional<CompactRouteInfo> route) const;
+
+        // Compacted id of every vertex of the original graph
+        std::vector<VertexId> compact_vertex_ids_;
+        // Original id of every edge of the compacted graph
+        std::vector<EdgeId> original_edge_ids_;
+        // Full-precision weight of every edge of the compacted graph, kept only if it's narrowed
+        std::vector<Weight> edge_weights_;
+        // Component of every compacted vertex
+        std::vector<uint32_t> component_ids_;
+        // The router refers to the compacted graph, so it's declared after it
+        std::unique_ptr<CompactGraph> compact_graph_;
+        std::unique_ptr<RouterBase<CompactWeight>> router_;
+    };
+
+    template <typename Weight, typename CompactWeight>
+    PrunedRouter<Weight, CompactWeight>::PrunedRouter(const Graph& graph, const RouterFactory& make_router, const EdgeWeigher& edge_weigher)
+        : compact_vertex_ids_(graph.GetVertexCount(), NO_VERTEX)
+    {
+        const size_t edge_count = graph.GetEdgeCount();
+        size_t routable_vertex_count = 0;
+        const auto mark_routable = [&](VertexId vertex) {
+            if (compact_vertex_ids_[vertex] == NO_VERTEX) {
+                compact_vertex_ids_[vertex] = 0;
+            }
+        };
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            if (!graph.IsEdgeRemoved(edge_id)) {
+                const Edge<Weight>& edge = graph.GetEdge(edge_id);
+                mark_routable(edge.from);
+                mark_routable(edge.to);
+            }
+        }
+        // Compacted ids keep the order of the original ones
+        for (VertexId& compact_vertex_id : compact_vertex_ids_) {
+            if (compact_vertex_id != NO_VERTEX) {
+                compact_vertex_id = routable_vertex_count++;
+            }
+        }
+
+        compact_graph_ = std::make_unique<CompactGraph>(routable_vertex_count);
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            if (graph.IsEdgeRemoved(edge_id)) {
+                continue;
+            }
+            const Edge<Weight>& edge = graph.GetEdge(edge_id);
+            const Weight weight = edge_weigher ? edge_weigher(edge) : edge.weight;
+            compact_graph_->AddEdge(Edge<CompactWeight>{ compact_vertex_ids_[edge.from], compact_vertex_ids_[edge.to],
+                edge.span_count, edge.bus_id, static_cast<CompactWeight>(weight), edge.distance });
+            original_edge_ids_.push_back(edge_id);
+            if constexpr (NARROWED) {
+                edge_weights_.push_back(weight);
+            }
+        }
+        compact_graph_->Freeze();
+        component_ids_ = FindStronglyConnectedComponents(*compact_graph_);
+        router_ = make_router(*compact_graph_);
+    }
+
+    template <typename Weight, typename CompactWeight>
+    VertexId PrunedRouter<Weight, CompactWeight>::GetCompactVertexId(VertexId vertex) const {
+        if (vertex >= compact_vertex_ids_.size()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        return compact_vertex_ids_[vertex];
+    }
+
+    template <typename Weight, typename CompactWeight>
+    bool PrunedRouter<Weight, CompactWeight>::IsUnreachable(VertexId from, VertexId to) const {
+        return from == NO_VERTEX || to == NO_VERTEX || component_ids_[to] > component_ids_[from];
+    }
+
+    template <typename Weight, typename CompactWeight>
+    std::optional<typename PrunedRouter<Weight, CompactWeight>::RouteInfo> PrunedRouter<Weight, CompactWeight>::RestoreRoute(
+        std::optional<CompactRouteInfo> route) const {
+        if (!route) {
+            return std::nullopt;
+        }
+        Weight weight{};
+        if constexpr (NARROWED) {
+            for (const EdgeId edge_id : route->edges) {
+                weight += edge_weights_[edge_id];
+            }
+        }
+        else {
+            weight = route->weight;
+        }
+        for (EdgeId& edge_id : route->edges) {
+            edge_id = original_edge_ids_[edge_id];
+        }
+        return RouteInfo{ weight, std::move(route->edges) };
+    }
+
+    template <typename Weight, typename CompactWeight>
+    std::optional<typename PrunedRouter<Weight, CompactWeight>::RouteInfo> PrunedRouter<Weight, CompactWeight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        const VertexId compact_from = GetCompactVertexId(from);
+        const VertexId compact_to = GetCompactVertexId(to);
+        if (from == to) {
+            return RouteInfo{ Weight{}, {} };
+        }
+        if (IsUnreachable(compact_from, compact_to)) {
+            return std::nullopt;
+        }
+        return RestoreRoute(router_->BuildRoute(compact_from, compact_to));
+    }
+
+    template <typename Weight, typename CompactWeight>
+    std::vector<std::optional<typename PrunedRouter<Weight, CompactWeight>::RouteInfo>> PrunedRouter<Weight, CompactWeight>::BuildRoutes(
+        VertexId from, const std::vector<VertexId>& targets) const {
+        const VertexId compact_from = GetCompactVertexId(from);
+        std::vector<std::optional<RouteInfo>> routes(targets.size());
+        // Only the targets that may be reachable are passed on, with their positions
+        std::vector<VertexId> searched_targets;
+        std::vector<size_t> searched_positions;
+        for (size_t i = 0; i < targets.size(); ++i) {
+            const VertexId compact_to = GetCompactVertexId(targets[i]);
+            if (targets[i] == from) {
+                routes[i] = RouteInfo{ Weight{}, {} };
+            }
+            else if (!IsUnreachable(compact_from, compact_to)) {
+                searched_targets.push_back(compact_to);
+                searched_positions.push_back(i);
+            }
+        }
+        if (searched_targets.empty()) {
+            return routes;
+        }
+        std::vector<std::optional<CompactRouteInfo>> searched_routes = router_->BuildRoutes(compact_from, searched_targets);
+        for (size_t i = 0; i < searched_routes.size(); ++i) {
+            routes[searched_positions[i]] = RestoreRoute(std::move(searched_routes[i]));
+        }
+        return routes;
+    }
+
+    template <typename Weight, typename CompactWeight>
+    size_t PrunedRouter<Weight, CompactWeight>::GetRoutableVertexCount() const {
+        return compact_graph_->GetVertexCount();
+    }
+
+}  // namespace graph
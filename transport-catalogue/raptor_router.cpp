@@ -0,0 +1,220 @@
+#include "raptor_router.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+namespace transport_catalogue
+{
+	namespace transport_router
+	{
+		namespace
+		{
+			constexpr double INFINITE_TIME = numeric_limits<double>::infinity();
+			constexpr uint32_t NO_POSITION = numeric_limits<uint32_t>::max();
+			//Search target of a one-to-many search, which prunes nothing
+			constexpr size_t NO_STOP = numeric_limits<size_t>::max();
+		}
+
+		RaptorRouter::RaptorRouter(const TransportCatalogue& catalogue, const RouteSettings& settings)
+			: catalogue_(catalogue)
+			, settings_(settings)
+			, stop_count_(catalogue.GetStops().size())
+			, stop_lines_(stop_count_)
+		{
+			for (const Bus& bus : catalogue_.GetBuses())
+			{
+				if (bus.stops.size() < 2)
+				{
+					continue;
+				}
+				AddLine(bus, bus.stops);
+				if (!bus.is_looped)
+				{
+					AddLine(bus, vector<const Stop*>(bus.stops.rbegin(), bus.stops.rend()));
+				}
+			}
+		}
+
+		void RaptorRouter::AddLine(const Bus& bus, const vector<const Stop*>& stops)
+		{
+			Line line{ &bus, {}, {} };
+			line.stops.reserve(stops.size());
+			line.distances_from_start.reserve(stops.size());
+			double distance = 0;
+			for (size_t i = 0; i != stops.size(); ++i)
+			{
+				if (i != 0)
+				{
+					distance += catalogue_.GetRealDistance(stops[i - 1], stops[i]);
+				}
+				line.stops.push_back(catalogue_.GetStopIndex(stops[i]));
+				line.distances_from_start.push_back(distance);
+			}
+			const uint32_t line_id = static_cast<uint32_t>(lines_.size());
+			for (uint32_t position = 0; position != line.stops.size(); ++position)
+			{
+				stop_lines_[line.stops[position]].push_back({ line_id, position });
+			}
+			lines_.push_back(move(line));
+		}
+
+		double RaptorRouter::GetRideTime(const Line& line, uint32_t board_position, uint32_t alight_position) const
+		{
+			const double distance = line.distances_from_start[alight_position] - line.distances_from_start[board_position];
+			return distance / settings_.bus_velocity * 60 / 1000;
+		}
+
+		optional<RouteResult> RaptorRouter::BuildRoute(size_t from, size_t to) const
+		{
+			if (from >= stop_count_ || to >= stop_count_)
+			{
+				throw out_of_range("Stop index is out of range");
+			}
+			if (from == to)
+			{
+				return RouteResult{ 0, {} };
+			}
+			return ExtractRoute(Search(from, to), to);
+		}
+
+		vector<optional<RouteResult>> RaptorRouter::BuildRoutes(size_t from, const vector<size_t>& targets) const
+		{
+			if (from >= stop_count_ || any_of(targets.begin(), targets.end(), [this](size_t to) { return to >= stop_count_; }))
+			{
+				throw out_of_range("Stop index is out of range");
+			}
+			const Rounds rounds = Search(from, NO_STOP);
+			vector<optional<RouteResult>> routes;
+			routes.reserve(targets.size());
+			for (size_t to : targets)
+			{
+				routes.push_back(to == from ? RouteResult{ 0, {} } : ExtractRoute(rounds, to));
+			}
+			return routes;
+		}
+
+		RaptorRouter::Rounds RaptorRouter::Search(size_t from, size_t target) const
+		{
+			const double wait_time = settings_.bus_wait_time;
+			const size_t max_rounds = settings_.raptor_max_rounds != 0 ? settings_.raptor_max_rounds : stop_count_;
+
+			Rounds result{ { vector<double>(stop_count_, INFINITE_TIME) }, { vector<Ride>(stop_count_) }, vector<double>(stop_count_, INFINITE_TIME) };
+			vector<vector<double>>& arrivals = result.arrivals;
+			vector<vector<Ride>>& rides = result.rides;
+			vector<double>& best_arrivals = result.best_arrivals;
+			arrivals[0][from] = 0;
+			best_arrivals[from] = 0;
+			auto target_arrival = [&best_arrivals, target]() { return target != NO_STOP ? best_arrivals[target] : INFINITE_TIME; };
+
+			vector<size_t> marked_stops{ from };
+			vector<bool> is_marked(stop_count_, false);
+			vector<uint32_t> first_marked_positions(lines_.size(), NO_POSITION);
+			vector<uint32_t> queued_lines;
+
+			for (size_t round = 1; round <= max_rounds && !marked_stops.empty(); ++round)
+			{
+				arrivals.push_back(vector<double>(stop_count_, INFINITE_TIME));
+				rides.push_back(vector<Ride>(stop_count_));
+				const vector<double>& previous_arrivals = arrivals[round - 1];
+				vector<double>& round_arrivals = arrivals[round];
+				vector<Ride>& round_rides = rides[round];
+
+				//Collect lines passing marked stops, each scanned from its first marked position
+				for (size_t stop : marked_stops)
+				{
+					for (const LineStop& line_stop : stop_lines_[stop])
+					{
+						uint32_t& first_position = first_marked_positions[line_stop.line];
+						if (first_position == NO_POSITION)
+						{
+							queued_lines.push_back(line_stop.line);
+						}
+						first_position = min(first_position, line_stop.position);
+					}
+				}
+				marked_stops.clear();
+
+				for (uint32_t line_id : queued_lines)
+				{
+					const Line& line = lines_[line_id];
+					uint32_t board_position = NO_POSITION;
+					double board_arrival = INFINITE_TIME;
+					for (uint32_t position = first_marked_positions[line_id]; position != line.stops.size(); ++position)
+					{
+						const size_t stop = line.stops[position];
+						if (board_position != NO_POSITION)
+						{
+							const double arrival = board_arrival + wait_time + GetRideTime(line, board_position, position);
+							//Arrivals no better than the best known one or the target's are pruned
+							if (arrival < best_arrivals[stop] && arrival < target_arrival())
+							{
+								round_arrivals[stop] = arrival;
+								round_rides[stop] = { line_id, board_position, position };
+								best_arrivals[stop] = arrival;
+								if (!is_marked[stop])
+								{
+									is_marked[stop] = true;
+									marked_stops.push_back(stop);
+								}
+							}
+						}
+						//Boarding here is better when it leaves a smaller arrival minus distance travelled so far
+						if (previous_arrivals[stop] != INFINITE_TIME
+							&& (board_position == NO_POSITION
+								|| previous_arrivals[stop] - GetRideTime(line, 0, position) < board_arrival - GetRideTime(line, 0, board_position)))
+						{
+							board_position = position;
+							board_arrival = previous_arrivals[stop];
+						}
+					}
+					first_marked_positions[line_id] = NO_POSITION;
+				}
+				queued_lines.clear();
+				for (size_t stop : marked_stops)
+				{
+					is_marked[stop] = false;
+				}
+			}
+
+			return result;
+		}
+
+		optional<RouteResult> RaptorRouter::ExtractRoute(const Rounds& rounds, size_t to) const
+		{
+			const vector<vector<double>>& arrivals = rounds.arrivals;
+			const vector<vector<Ride>>& rides = rounds.rides;
+			const vector<double>& best_arrivals = rounds.best_arrivals;
+			if (best_arrivals[to] == INFINITE_TIME)
+			{
+				return nullopt;
+			}
+
+			size_t round = 0;
+			for (size_t k = 1; k != arrivals.size(); ++k)
+			{
+				if (arrivals[k][to] == best_arrivals[to])
+				{
+					round = k;
+					break;
+				}
+			}
+
+			RouteResult result{ best_arrivals[to], {} };
+			for (size_t stop = to; round != 0; --round)
+			{
+				const Ride& ride = rides[round][stop];
+				const Line& line = lines_[ride.line];
+				const size_t board_stop = line.stops[ride.board_position];
+				result.items.push_back({ catalogue_.GetStops()[board_stop].name, line.bus->name,
+					static_cast<int>(ride.alight_position - ride.board_position), GetRideTime(line, ride.board_position, ride.alight_position) });
+				stop = board_stop;
+			}
+			reverse(result.items.begin(), result.items.end());
+			return result;
+		}
+	}
+}
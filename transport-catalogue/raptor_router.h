@@ -0,0 +1,74 @@
+#pragma once
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace transport_catalogue
+{
+	namespace transport_router
+	{
+		struct RouteResult;
+
+		// Round-based route search over Bus stop sequences (RAPTOR without timetables:
+		// every ride costs the fixed wait time plus the ride time). Round k finds the
+		// cheapest arrivals using exactly k rides, so no graph edges are materialized
+		// and max_rounds bounds the number of rides.
+		class RaptorRouter
+		{
+		public:
+			RaptorRouter(const TransportCatalogue& catalogue, const RouteSettings& settings);
+
+			std::optional<RouteResult>			BuildRoute(size_t from, size_t to) const;
+			//One search from the source, without pruning by target, serves every target
+			std::vector<std::optional<RouteResult>> BuildRoutes(size_t from, const std::vector<size_t>& targets) const;
+
+		private:
+			// One direction of a bus
+			struct Line
+			{
+				const Bus*						bus;
+				std::vector<size_t>				stops;
+				std::vector<double>				distances_from_start;
+			};
+
+			struct LineStop
+			{
+				uint32_t						line;
+				uint32_t						position;
+			};
+
+			// How the cheapest arrival of a round was reached
+			struct Ride
+			{
+				uint32_t						line;
+				uint32_t						board_position;
+				uint32_t						alight_position;
+			};
+
+			//arrivals[k][stop] - cheapest arrival with exactly k rides, rides[k][stop] - its last ride
+			struct Rounds
+			{
+				std::vector<std::vector<double>>	arrivals;
+				std::vector<std::vector<Ride>>		rides;
+				std::vector<double>					best_arrivals;
+			};
+
+			//Pruned by the arrival at target unless it's NO_STOP
+			Rounds								Search(size_t from, size_t target) const;
+			std::optional<RouteResult>			ExtractRoute(const Rounds& rounds, size_t to) const;
+			void								AddLine(const Bus& bus, const std::vector<const Stop*>& stops);
+			double								GetRideTime(const Line& line, uint32_t board_position, uint32_t alight_position) const;
+
+			const TransportCatalogue&			catalogue_;
+			RouteSettings						settings_;
+			size_t								stop_count_;
+			std::vector<Line>					lines_;
+			std::vector<std::vector<LineStop>>	stop_lines_;
+		};
+	}
+}
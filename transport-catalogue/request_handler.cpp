@@ -24,6 +24,11 @@ namespace transport_catalogue
 			json_reader_.ProcessBaseRequests(); 
 		}
 
+		void RequestHandler::UpdateData()
+		{
+			json_reader_.ProcessBaseUpdates();
+		}
+
 		void RequestHandler::ProcessRequests(std::ostream& output)
 		{
 			json_reader_.ProcessStatRequests(output);
@@ -47,5 +52,10 @@ namespace transport_catalogue
 			return json_reader_.GetSerializationFilename();
 		}
 
+		cache::CacheStats RequestHandler::GetRouteCacheStats() const
+		{
+			return json_reader_.GetRouteCacheStats();
+		}
+
 	}
 }
\ No newline at end of file
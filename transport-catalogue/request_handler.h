@@ -16,11 +16,14 @@ namespace transport_catalogue
 			RequestHandler(TransportCatalogue& transport_catalogue);
 
 			void						LoadDataIntoTC(std::istream& input);
+			//Applies the updates of an already loaded document to a deserialized catalogue
+			void						UpdateData();
 			void						ProcessRequests(std::ostream& output);
 			//void						PrintResult();
 			void						LoadJsonDocument(std::istream& input);
 			void						RenderMap(std::ostream& output);
 			std::string					GetSerializationFilename() const;
+			cache::CacheStats			GetRouteCacheStats() const;
 
 		private:
 			TransportCatalogue&			transport_catalogue_;
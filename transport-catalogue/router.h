@@ -1,11 +1,15 @@
 #pragma once
 
 #include "graph.h"
+#include "min_plus_kernel.h"
+#include "parallel.h"
+#include "router_base.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -15,90 +19,213 @@
 namespace graph {
 
     template <typename Weight>
-    class Router {
+    class Router : public RouterBase<Weight> {
     private:
         using Graph = DirectedWeightedGraph<Weight>;
 
     public:
-        explicit Router(const Graph& graph);
-        void RouterAfterInitialization();
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+        // Edge ids in the table are 32-bit: a graph with more edges would not fit the V x V table anyway
+        using PackedEdgeId = min_plus::PackedEdgeId;
 
-        struct RouteInfo {
-            Weight weight;
-            std::vector<EdgeId> edges;
+        // Row-major vertex_count x vertex_count table of the computed routes.
+        // Missing routes have INFINITE_WEIGHT, routes without a previous edge have NO_EDGE.
+        struct RoutesTable {
+            size_t vertex_count = 0;
+            std::vector<Weight> weights;
+            std::vector<PackedEdgeId> prev_edges;
         };
 
-        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+        static constexpr PackedEdgeId NO_EDGE = std::numeric_limits<PackedEdgeId>::max();
 
-    private:
-        struct RouteInternalData {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
-        };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+        // thread_count = 0 uses every hardware thread
+        explicit Router(const Graph& graph, size_t thread_count = 1);
+        // Restores precomputed routes without relaxation
+        Router(const Graph& graph, RoutesTable routes_table);
+        void RouterAfterInitialization();
 
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        const RoutesTable& ExportRoutesTable() const;
+        // Bytes the routes table of a graph with vertex_count vertices takes
+        static size_t EstimateMemoryUsage(size_t vertex_count);
+
+        // Repairs the routes of a graph that gained the given edges (or whose given edges got
+        // cheaper) since the table was computed; new vertices are appended to the table.
+        // Only valid if no route could get longer: removed or heavier edges need a full rebuild
+        static void InsertEdges(const Graph& graph, RoutesTable& routes_table, const std::vector<EdgeId>& edge_ids, size_t thread_count = 1);
+
+    private:
         void InitializeRoutesInternalData(const Graph& graph) {
             const size_t vertex_count = graph.GetVertexCount();
+            if (graph.GetEdgeCount() >= NO_EDGE) {
+                throw std::length_error("Too many edges for the routes table");
+            }
+            routes_internal_data_.vertex_count = vertex_count;
+            routes_internal_data_.weights.assign(vertex_count * vertex_count, INFINITE_WEIGHT);
+            routes_internal_data_.prev_edges.assign(vertex_count * vertex_count, NO_EDGE);
+
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
-                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                    const auto& edge = graph.GetEdge(edge_id);
-                    if (edge.weight < ZERO_WEIGHT) {
+                Weight* weights_row = &routes_internal_data_.weights[vertex * vertex_count];
+                PackedEdgeId* prev_edges_row = &routes_internal_data_.prev_edges[vertex * vertex_count];
+                weights_row[vertex] = ZERO_WEIGHT;
+                graph.ForEachIncidentEdge(vertex, [&](EdgeId edge_id, VertexId to, const Weight& edge_weight) {
+                    if (edge_weight < ZERO_WEIGHT) {
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                    if (weights_row[to] > edge_weight) {
+                        weights_row[to] = edge_weight;
+                        prev_edges_row[to] = static_cast<PackedEdgeId>(edge_id);
                     }
+                });
+            }
+        }
+
+        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
+            RelaxRowsThroughVertex(routes_internal_data_, vertex_through, 0, vertex_count);
+        }
+
+        // Relaxing through vertex_through never changes its own row and column (the diagonal
+        // is zero and weights are non-negative), so disjoint row blocks are independent within one pass
+        static void RelaxRowsThroughVertex(RoutesTable& routes_table, VertexId vertex_through, VertexId rows_begin, VertexId rows_end) {
+            const size_t vertex_count = routes_table.vertex_count;
+            const Weight* through_weights = &routes_table.weights[vertex_through * vertex_count];
+            const PackedEdgeId* through_prev_edges = &routes_table.prev_edges[vertex_through * vertex_count];
+            for (VertexId vertex_from = rows_begin; vertex_from < rows_end; ++vertex_from) {
+                Weight* weights_row = &routes_table.weights[vertex_from * vertex_count];
+                PackedEdgeId* prev_edges_row = &routes_table.prev_edges[vertex_from * vertex_count];
+                const Weight weight_from = weights_row[vertex_through];
+                if (weight_from == INFINITE_WEIGHT) {
+                    continue;
                 }
+                min_plus::RelaxRow(weights_row, prev_edges_row, through_weights, through_prev_edges,
+                                   vertex_count, weight_from, prev_edges_row[vertex_through]);
             }
         }
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-            const RouteInternalData& route_to) {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-                route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
+        void RelaxRoutesInternalData(size_t thread_count) {
+            RelaxThroughVertices(routes_internal_data_, routes_internal_data_.vertex_count, [](size_t index) { return index; }, thread_count);
+        }
+
+        // Relaxes the whole table through pivot_at(0), ..., pivot_at(pivot_count - 1).
+        // Every thread owns a block of rows and walks all pivots in order, meeting the others
+        // at a barrier after each one: the relaxations and their order per cell are the same
+        // as in the sequential loop, so the resulting table is bit-identical
+        template <typename PivotAt>
+        static void RelaxThroughVertices(RoutesTable& routes_table, size_t pivot_count, PivotAt pivot_at, size_t thread_count) {
+            const size_t vertex_count = routes_table.vertex_count;
+            thread_count = std::min(parallel::ResolveThreadCount(thread_count), std::max<size_t>(1, vertex_count / MIN_ROWS_PER_THREAD));
+            if (thread_count <= 1) {
+                for (size_t pivot_index = 0; pivot_index != pivot_count; ++pivot_index) {
+                    RelaxRowsThroughVertex(routes_table, pivot_at(pivot_index), 0, vertex_count);
+                }
+                return;
             }
+            parallel::Barrier barrier(thread_count);
+            parallel::RunThreads(thread_count, [&](size_t thread_index) {
+                const VertexId rows_begin = vertex_count * thread_index / thread_count;
+                const VertexId rows_end = vertex_count * (thread_index + 1) / thread_count;
+                for (size_t pivot_index = 0; pivot_index != pivot_count; ++pivot_index) {
+                    RelaxRowsThroughVertex(routes_table, pivot_at(pivot_index), rows_begin, rows_end);
+                    barrier.ArriveAndWait();
+                }
+            });
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                        }
-                    }
+        // Re-lays the table out for a larger vertex count, new vertices only reach themselves
+        static void GrowRoutesTable(RoutesTable& routes_table, size_t vertex_count) {
+            const size_t old_vertex_count = routes_table.vertex_count;
+            std::vector<Weight> weights(vertex_count * vertex_count, INFINITE_WEIGHT);
+            std::vector<PackedEdgeId> prev_edges(vertex_count * vertex_count, NO_EDGE);
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                if (vertex < old_vertex_count) {
+                    std::copy_n(&routes_table.weights[vertex * old_vertex_count], old_vertex_count, &weights[vertex * vertex_count]);
+                    std::copy_n(&routes_table.prev_edges[vertex * old_vertex_count], old_vertex_count, &prev_edges[vertex * vertex_count]);
+                }
+                else {
+                    weights[vertex * vertex_count + vertex] = ZERO_WEIGHT;
                 }
             }
+            routes_table = { vertex_count, std::move(weights), std::move(prev_edges) };
         }
 
+        static constexpr size_t MIN_ROWS_PER_THREAD = 64;
         static constexpr Weight ZERO_WEIGHT{};
         const Graph& graph_;
-        RoutesInternalData routes_internal_data_;
+        RoutesTable routes_internal_data_;
     };
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    Router<Weight>::Router(const Graph& graph, size_t thread_count)
         : graph_(graph)
     {
-        routes_internal_data_ = { graph.GetVertexCount(), std::vector<std::optional<RouteInternalData>>(graph_.GetVertexCount()) };
         InitializeRoutesInternalData(graph);
+        RelaxRoutesInternalData(thread_count);
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, RoutesTable routes_table)
+        : graph_(graph)
+        , routes_internal_data_(std::move(routes_table))
+    {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (routes_internal_data_.vertex_count != vertex_count
+            || routes_internal_data_.weights.size() != vertex_count * vertex_count
+            || routes_internal_data_.prev_edges.size() != vertex_count * vertex_count) {
+            throw std::invalid_argument("Routes table doesn't match the graph");
+        }
+    }
+
+    template <typename Weight>
+    const typename Router<Weight>::RoutesTable& Router<Weight>::ExportRoutesTable() const {
+        return routes_internal_data_;
+    }
+
+    template <typename Weight>
+    size_t Router<Weight>::EstimateMemoryUsage(size_t vertex_count) {
+        return vertex_count * vertex_count * (sizeof(Weight) + sizeof(PackedEdgeId));
+    }
+
+    // New routes run through the new edges, and split at the edges' ends into pieces that are
+    // either a new edge or an old shortest route. So relaxing the old table (plus the new edges)
+    // through these ends only, rather than through every vertex, already finds all of them
+    template <typename Weight>
+    void Router<Weight>::InsertEdges(const Graph& graph, RoutesTable& routes_table, const std::vector<EdgeId>& edge_ids, size_t thread_count) {
         const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through != vertex_count; ++vertex_through) 
-        {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        if (vertex_count < routes_table.vertex_count) {
+            throw std::invalid_argument("Routes table doesn't match the graph");
+        }
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for the routes table");
+        }
+        if (vertex_count > routes_table.vertex_count) {
+            GrowRoutesTable(routes_table, vertex_count);
+        }
+
+        std::vector<VertexId> pivots;
+        pivots.reserve(edge_ids.size() * 2);
+        for (const EdgeId edge_id : edge_ids) {
+            const Edge<Weight>& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            const size_t cell = edge.from * vertex_count + edge.to;
+            if (routes_table.weights[cell] > edge.weight) {
+                routes_table.weights[cell] = edge.weight;
+                routes_table.prev_edges[cell] = static_cast<PackedEdgeId>(edge_id);
+            }
+            pivots.push_back(edge.from);
+            pivots.push_back(edge.to);
         }
+        std::sort(pivots.begin(), pivots.end());
+        pivots.erase(std::unique(pivots.begin(), pivots.end()), pivots.end());
+
+        RelaxThroughVertices(routes_table, pivots.size(), [&pivots](size_t index) { return pivots[index]; }, thread_count);
     }
 
     template <typename Weight>
     void Router<Weight>::RouterAfterInitialization()
     {
-        routes_internal_data_ = { graph_.GetVertexCount(), std::vector<std::optional<RouteInternalData>>(graph_.GetVertexCount()) };
-
         InitializeRoutesInternalData(graph_);
 
         const size_t vertex_count = graph_.GetVertexCount();
@@ -111,21 +238,25 @@ namespace graph {
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const size_t row_offset = from * vertex_count;
+        const Weight weight = routes_internal_data_.weights[row_offset + to];
+        if (weight == INFINITE_WEIGHT) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
         std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+        for (PackedEdgeId edge_id = routes_internal_data_.prev_edges[row_offset + to];
+            edge_id != NO_EDGE;
+            edge_id = routes_internal_data_.prev_edges[row_offset + graph_.GetEdge(edge_id).from])
         {
-            edges.push_back(*edge_id);
+            edges.push_back(edge_id);
         }
         std::reverse(edges.begin(), edges.end());
 
         return RouteInfo{ weight, std::move(edges) };
     }
 
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
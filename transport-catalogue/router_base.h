@@ -0,0 +1,36 @@
+#pragma once
+
+#include "graph.h"
+
+#include <optional>
+#include <vector>
+
+namespace graph {
+
+    // Common interface of the routing engines, so that request processing
+    // does not depend on how shortest paths are actually obtained.
+    template <typename Weight>
+    class RouterBase {
+    public:
+        struct RouteInfo {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        virtual ~RouterBase() = default;
+
+        virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+        // Routes from one source to each of the targets. Engines that search
+        // from the source override it to search once for all of them
+        virtual std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+            std::vector<std::optional<RouteInfo>> routes;
+            routes.reserve(targets.size());
+            for (const VertexId to : targets) {
+                routes.push_back(BuildRoute(from, to));
+            }
+            return routes;
+        }
+    };
+
+}  // namespace graph
@@ -145,6 +145,16 @@ namespace transport_catalogue
         TC_route_settings serialization_routing_settings;
         serialization_routing_settings.set_bus_wait_time(routing_settings.bus_wait_time);
         serialization_routing_settings.set_bus_velocity(routing_settings.bus_velocity);
+        serialization_routing_settings.set_bus_velocity_precise(routing_settings.bus_velocity);
+        serialization_routing_settings.set_router_engine(static_cast<uint32_t>(routing_settings.router_engine));
+        serialization_routing_settings.set_precompute_routes(routing_settings.precompute_routes);
+        serialization_routing_settings.set_router_threads(routing_settings.router_threads);
+        serialization_routing_settings.set_graph_model(static_cast<uint32_t>(routing_settings.graph_model));
+        serialization_routing_settings.set_compact_graph(routing_settings.compact_graph);
+        serialization_routing_settings.set_raptor_max_rounds(routing_settings.raptor_max_rounds);
+        serialization_routing_settings.set_router_memory_budget(routing_settings.router_memory_budget);
+        serialization_routing_settings.set_router_weights(static_cast<uint32_t>(routing_settings.router_weights));
+        serialization_routing_settings.set_stop_order(static_cast<uint32_t>(routing_settings.stop_order));
         
         return serialization_routing_settings;
     }
@@ -153,7 +163,18 @@ namespace transport_catalogue
     {
         RouteSettings routing_settings;
         routing_settings.bus_wait_time = serialization_routing_settings.bus_wait_time();
-        routing_settings.bus_velocity = serialization_routing_settings.bus_velocity();
+        //Bases written before the precise field have only the truncated one
+        routing_settings.bus_velocity = serialization_routing_settings.bus_velocity_precise() != 0
+            ? serialization_routing_settings.bus_velocity_precise() : serialization_routing_settings.bus_velocity();
+        routing_settings.router_engine = static_cast<RouterEngine>(serialization_routing_settings.router_engine());
+        routing_settings.precompute_routes = serialization_routing_settings.precompute_routes();
+        routing_settings.router_threads = serialization_routing_settings.router_threads();
+        routing_settings.graph_model = static_cast<GraphModel>(serialization_routing_settings.graph_model());
+        routing_settings.compact_graph = serialization_routing_settings.compact_graph();
+        routing_settings.raptor_max_rounds = serialization_routing_settings.raptor_max_rounds();
+        routing_settings.router_memory_budget = serialization_routing_settings.router_memory_budget();
+        routing_settings.router_weights = static_cast<RouterWeights>(serialization_routing_settings.router_weights());
+        routing_settings.stop_order = static_cast<StopOrder>(serialization_routing_settings.stop_order());
         
         return routing_settings;
     }
@@ -161,14 +182,18 @@ namespace transport_catalogue
     TC_graph PackGraph(const Graph& graph) 
     {
         TC_graph serialization_graph;
+        serialization_graph.set_vertex_count(graph.GetVertexCount());
         transport_catalogue_serialize::Edge serialization_edge;
-        for (const graph::Edge<double>& edge : graph) 
+        for (graph::EdgeId edge_id = 0; edge_id != graph.GetEdgeCount(); ++edge_id) 
         {
+            const graph::Edge<double>& edge = graph.GetEdge(edge_id);
             serialization_edge.set_from_id(edge.from);
             serialization_edge.set_to_id(edge.to);
             serialization_edge.set_span_count(edge.span_count);
-            serialization_edge.set_bus_name(string(edge.bus_name));
+            serialization_edge.set_bus_id(edge.bus_id);
             serialization_edge.set_weight(edge.weight);
+            serialization_edge.set_is_removed(graph.IsEdgeRemoved(edge_id));
+            serialization_edge.set_distance(edge.distance);
 
             *serialization_graph.mutable_edges()->Add() = serialization_edge;
         }
@@ -176,26 +201,186 @@ namespace transport_catalogue
         return serialization_graph;
     }
 
-    Graph UnpackGraph(const TC_graph& serialization_graph, size_t vertex_count) 
+    Graph UnpackGraph(const TC_graph& serialization_graph, const TransportCatalogue& catalogue) 
     {
         size_t edges_count = serialization_graph.edges_size();
-        Graph graph(vertex_count);  
+        //Bases written before vertex_count was stored only have stop vertices
+        Graph graph(serialization_graph.vertex_count() != 0 ? serialization_graph.vertex_count() : catalogue.GetStops().size());
+        //Bases written before bus ids name the bus of every edge
+        std::unordered_map<std::string_view, graph::BusId> legacy_bus_ids;
+        for (graph::BusId bus_id = 0; bus_id != catalogue.GetBuses().size(); ++bus_id)
+        {
+            legacy_bus_ids.emplace(catalogue.GetBuses()[bus_id].name, bus_id);
+        }
+        //Distances of older bases are recovered from the weights they were baked into
+        const RouteSettings& route_settings = catalogue.GetRouteSettings();
+        const EdgeWeigher weigher = catalogue.GetEdgeWeigher(route_settings);
         for (size_t i = 0; i != edges_count; ++i) 
         {
             const transport_catalogue_serialize::Edge& serialization_edge = serialization_graph.edges(i);
-            graph.AddEdge
-            ({
+            graph::Edge<double> edge
+            {
                 serialization_edge.from_id(),
                 serialization_edge.to_id(),
                 serialization_edge.span_count(),
-                serialization_edge.bus_name(),
-                serialization_edge.weight()
-            });
+                serialization_edge.bus_name().empty() ? serialization_edge.bus_id() : legacy_bus_ids.at(serialization_edge.bus_name()),
+                serialization_edge.weight(),
+                serialization_edge.distance()
+            };
+            if (!serialization_edge.has_distance())
+            {
+                //With zero distance the weigher gives just the boarding wait
+                edge.distance = (edge.weight - weigher(edge)) * route_settings.bus_velocity * 1000 / 60;
+            }
+            const graph::EdgeId edge_id = graph.AddEdge(edge);
+            if (serialization_edge.is_removed())
+            {
+                graph.RemoveEdge(edge_id);
+            }
         }
         
         return graph;
     }
 
+    TC_routes_table PackRoutesTable(const RoutesTable& routes_table)
+    {
+        TC_routes_table serialization_routes_table;
+        serialization_routes_table.set_version(ROUTES_TABLE_VERSION);
+        serialization_routes_table.set_vertex_count(routes_table.vertex_count);
+        serialization_routes_table.mutable_weights()->Reserve(routes_table.weights.size());
+        for (double weight : routes_table.weights)
+        {
+            serialization_routes_table.add_weights(weight);
+        }
+        serialization_routes_table.mutable_prev_edges()->Reserve(routes_table.prev_edges.size());
+        for (uint32_t prev_edge : routes_table.prev_edges)
+        {
+            serialization_routes_table.add_prev_edges(prev_edge == graph::Router<double>::NO_EDGE ? 0 : prev_edge + 1);
+        }
+
+        return serialization_routes_table;
+    }
+
+    std::optional<RoutesTable> UnpackRoutesTable(const TC_routes_table& serialization_routes_table)
+    {
+        if (serialization_routes_table.version() != ROUTES_TABLE_VERSION)
+        {
+            return std::nullopt;
+        }
+        RoutesTable routes_table;
+        routes_table.vertex_count = serialization_routes_table.vertex_count();
+        routes_table.weights.assign(serialization_routes_table.weights().begin(), serialization_routes_table.weights().end());
+        routes_table.prev_edges.reserve(serialization_routes_table.prev_edges_size());
+        for (uint32_t prev_edge : serialization_routes_table.prev_edges())
+        {
+            routes_table.prev_edges.push_back(prev_edge == 0 ? graph::Router<double>::NO_EDGE : prev_edge - 1);
+        }
+
+        return routes_table;
+    }
+
+    TC_contraction_hierarchy PackContractionHierarchy(const ContractionHierarchy& contraction_hierarchy)
+    {
+        TC_contraction_hierarchy serialization_contraction_hierarchy;
+        serialization_contraction_hierarchy.set_version(CONTRACTION_HIERARCHY_VERSION);
+        for (uint32_t rank : contraction_hierarchy.ranks)
+        {
+            serialization_contraction_hierarchy.add_ranks(rank);
+        }
+        auto pack_id = [](uint32_t id) { return id == ContractionHierarchy::NO_ARC ? 0 : id + 1; };
+        for (const ContractionHierarchy::Arc& arc : contraction_hierarchy.arcs)
+        {
+            transport_catalogue_serialize::ContractionHierarchyArc& serialization_arc = *serialization_contraction_hierarchy.add_arcs();
+            serialization_arc.set_from_id(arc.from);
+            serialization_arc.set_to_id(arc.to);
+            serialization_arc.set_weight(arc.weight);
+            if (arc.IsShortcut())
+            {
+                serialization_arc.set_first_child(pack_id(arc.first_child));
+                serialization_arc.set_second_child(pack_id(arc.second_child));
+            }
+            else
+            {
+                serialization_arc.set_edge_id(arc.edge_id + 1);
+            }
+        }
+
+        return serialization_contraction_hierarchy;
+    }
+
+    std::optional<ContractionHierarchy> UnpackContractionHierarchy(const TC_contraction_hierarchy& serialization_contraction_hierarchy)
+    {
+        if (serialization_contraction_hierarchy.version() != CONTRACTION_HIERARCHY_VERSION)
+        {
+            return std::nullopt;
+        }
+        ContractionHierarchy contraction_hierarchy;
+        contraction_hierarchy.ranks.assign(serialization_contraction_hierarchy.ranks().begin(), serialization_contraction_hierarchy.ranks().end());
+        contraction_hierarchy.arcs.reserve(serialization_contraction_hierarchy.arcs_size());
+        auto unpack_id = [](uint32_t id) { return id == 0 ? ContractionHierarchy::NO_ARC : id - 1; };
+        for (const transport_catalogue_serialize::ContractionHierarchyArc& serialization_arc : serialization_contraction_hierarchy.arcs())
+        {
+            contraction_hierarchy.arcs.push_back
+            ({
+                serialization_arc.from_id(),
+                serialization_arc.to_id(),
+                serialization_arc.weight(),
+                serialization_arc.edge_id() == 0 ? 0 : serialization_arc.edge_id() - 1,
+                unpack_id(serialization_arc.first_child()),
+                unpack_id(serialization_arc.second_child())
+            });
+        }
+
+        return contraction_hierarchy;
+    }
+
+    TC_hub_labels PackHubLabels(const HubLabels& hub_labels)
+    {
+        TC_hub_labels serialization_hub_labels;
+        serialization_hub_labels.set_version(HUB_LABELS_VERSION);
+        auto pack_label_set = [](const HubLabels::LabelSet& label_set, transport_catalogue_serialize::HubLabelSet& serialization_label_set)
+        {
+            serialization_label_set.mutable_offsets()->Add(label_set.offsets.begin(), label_set.offsets.end());
+            serialization_label_set.mutable_hubs()->Add(label_set.hubs.begin(), label_set.hubs.end());
+            serialization_label_set.mutable_weights()->Add(label_set.weights.begin(), label_set.weights.end());
+            serialization_label_set.mutable_edges()->Reserve(label_set.edges.size());
+            for (graph::EdgeId edge_id : label_set.edges)
+            {
+                serialization_label_set.add_edges(edge_id == HubLabels::NO_EDGE ? 0 : edge_id + 1);
+            }
+        };
+        pack_label_set(hub_labels.out_labels, *serialization_hub_labels.mutable_out_labels());
+        pack_label_set(hub_labels.in_labels, *serialization_hub_labels.mutable_in_labels());
+
+        return serialization_hub_labels;
+    }
+
+    std::optional<HubLabels> UnpackHubLabels(const TC_hub_labels& serialization_hub_labels)
+    {
+        if (serialization_hub_labels.version() != HUB_LABELS_VERSION)
+        {
+            return std::nullopt;
+        }
+        auto unpack_label_set = [](const transport_catalogue_serialize::HubLabelSet& serialization_label_set)
+        {
+            HubLabels::LabelSet label_set;
+            label_set.offsets.assign(serialization_label_set.offsets().begin(), serialization_label_set.offsets().end());
+            label_set.hubs.assign(serialization_label_set.hubs().begin(), serialization_label_set.hubs().end());
+            label_set.weights.assign(serialization_label_set.weights().begin(), serialization_label_set.weights().end());
+            label_set.edges.reserve(serialization_label_set.edges_size());
+            for (uint32_t edge_id : serialization_label_set.edges())
+            {
+                label_set.edges.push_back(edge_id == 0 ? HubLabels::NO_EDGE : edge_id - 1);
+            }
+            return label_set;
+        };
+        HubLabels hub_labels;
+        hub_labels.out_labels = unpack_label_set(serialization_hub_labels.out_labels());
+        hub_labels.in_labels = unpack_label_set(serialization_hub_labels.in_labels());
+
+        return hub_labels;
+    }
+
     transport_catalogue_serialize::Stop PackStop(const Stop& stop) 
     {
         transport_catalogue_serialize::Coordinates serialization_coords;
@@ -215,6 +400,7 @@ namespace transport_catalogue
         transport_catalogue_serialize::Bus serialization_bus;
         serialization_bus.set_name(bus.name);
         serialization_bus.set_is_roundtrip(bus.is_looped);
+        serialization_bus.set_is_removed(bus.is_removed);
 
         for (const Stop* stop_ptr : bus.stops) 
         {
@@ -269,6 +455,40 @@ namespace transport_catalogue
         const Graph& gr = catalogue.GetGraph();
         *transport_catalogue_to_serialize.mutable_graph() = PackGraph(gr);
 
+        //An updated base keeps the routing data the catalogue has repaired, a routes table
+        //the updates dropped is built again if the base was made with precompute_routes
+        if (catalogue.GetRoutesTable()) 
+        {
+            *transport_catalogue_to_serialize.mutable_routes_table() = PackRoutesTable(*catalogue.GetRoutesTable());
+        }
+        else if (routing_settings.precompute_routes && transport_router::FitsMemoryBudget(graph::Router<double>::EstimateMemoryUsage(gr.GetVertexCount()), routing_settings)) 
+        {
+            graph::Router<double> router(gr, routing_settings.router_threads);
+            *transport_catalogue_to_serialize.mutable_routes_table() = PackRoutesTable(router.ExportRoutesTable());
+        }
+        else if (routing_settings.precompute_routes) 
+        {
+            std::clog << "precompute_routes: the routes table doesn't fit router_memory_budget, routes are left to be searched on demand"sv << std::endl;
+        }
+
+        if (catalogue.GetContractionHierarchy()) 
+        {
+            *transport_catalogue_to_serialize.mutable_contraction_hierarchy() = PackContractionHierarchy(*catalogue.GetContractionHierarchy());
+        }
+        else if (routing_settings.router_engine == RouterEngine::CONTRACTION_HIERARCHIES) 
+        {
+            *transport_catalogue_to_serialize.mutable_contraction_hierarchy() = PackContractionHierarchy(graph::BuildContractionHierarchy(gr));
+        }
+
+        if (catalogue.GetHubLabels()) 
+        {
+            *transport_catalogue_to_serialize.mutable_hub_labels() = PackHubLabels(*catalogue.GetHubLabels());
+        }
+        else if (routing_settings.router_engine == RouterEngine::HUB_LABELS) 
+        {
+            *transport_catalogue_to_serialize.mutable_hub_labels() = PackHubLabels(transport_router::BuildHubLabels(gr));
+        }
+
         std::ofstream ofs(filename, ios::binary);
         transport_catalogue_to_serialize.SerializeToOstream(&ofs);
         ofs.close();
@@ -296,6 +516,10 @@ namespace transport_catalogue
                 stops.push_back(catalogue.GetStopnameByIndex(serialization_bus.stop_index(j)));
             }
             catalogue.AddBus(serialization_bus.name(), stops, serialization_bus.is_roundtrip());
+            if (serialization_bus.is_removed()) 
+            {
+                catalogue.RemoveBus(serialization_bus.name());
+            }
         }
 
         for (size_t i = 0; i != transport_catalogue_serialized.distances_size(); ++i) 
@@ -312,7 +536,28 @@ namespace transport_catalogue
         TC_route_settings serialization_routing_settings = transport_catalogue_serialized.route_settings();
         catalogue.AddRouteSettings(UnpackRoutingSettings(serialization_routing_settings));
         TC_graph serialization_graphaph = transport_catalogue_serialized.graph();
-        catalogue.SetGraph(UnpackGraph(serialization_graphaph, catalogue.GetStops().size()));
+        catalogue.SetGraph(UnpackGraph(serialization_graphaph, catalogue));
+        if (transport_catalogue_serialized.has_routes_table()) 
+        {
+            if (std::optional<RoutesTable> routes_table = UnpackRoutesTable(transport_catalogue_serialized.routes_table())) 
+            {
+                catalogue.SetRoutesTable(std::move(*routes_table));
+            }
+        }
+        if (transport_catalogue_serialized.has_contraction_hierarchy()) 
+        {
+            if (std::optional<ContractionHierarchy> contraction_hierarchy = UnpackContractionHierarchy(transport_catalogue_serialized.contraction_hierarchy())) 
+            {
+                catalogue.SetContractionHierarchy(std::make_shared<const ContractionHierarchy>(std::move(*contraction_hierarchy)));
+            }
+        }
+        if (transport_catalogue_serialized.has_hub_labels()) 
+        {
+            if (std::optional<HubLabels> hub_labels = UnpackHubLabels(transport_catalogue_serialized.hub_labels())) 
+            {
+                catalogue.SetHubLabels(std::make_shared<const HubLabels>(std::move(*hub_labels)));
+            }
+        }
 
         ifs.close();
     }
@@ -4,11 +4,15 @@
 #include "map_renderer.h"
 #include "svg.h"
 #include "graph.h"
+#include "transport_router.h"
 
 #include <transport_catalogue.pb.h>
 
 #include <string>
+#include <string_view>
 #include <fstream>
+#include <iostream>
+#include <unordered_map>
 
 namespace transport_catalogue 
 {
@@ -23,6 +27,19 @@ namespace transport_catalogue
     using TC_graph = transport_catalogue_serialize::DirectedWeightedGraph;
     using Graph = graph::DirectedWeightedGraph<double>;
 
+    using TC_routes_table = transport_catalogue_serialize::RoutesTable;
+    using RoutesTable = TransportCatalogue::RoutesTable;
+    //Bumped whenever the meaning of the persisted routes table changes
+    inline const uint32_t ROUTES_TABLE_VERSION = 1;
+
+    using TC_contraction_hierarchy = transport_catalogue_serialize::ContractionHierarchy;
+    using ContractionHierarchy = graph::ContractionHierarchy<double>;
+    inline const uint32_t CONTRACTION_HIERARCHY_VERSION = 1;
+
+    using TC_hub_labels = transport_catalogue_serialize::HubLabels;
+    using HubLabels = graph::HubLabels<double>;
+    inline const uint32_t HUB_LABELS_VERSION = 1;
+
     void                Serialize(const TransportCatalogue& transport_catalogue, const std::string& filename);
     void                Deserialize(const std::string& filename,  TransportCatalogue& transport_catalogue);
 
@@ -36,7 +53,16 @@ namespace transport_catalogue
     RouteSettings       UnpackRouteSettings(const TC_route_settings& ser_routing_settings);
 
     TC_graph            PackGraph(const Graph& gr);
-    Graph               UnpackGraph(const TC_graph& ser_gr, size_t vertex_count);
+    Graph               UnpackGraph(const TC_graph& ser_gr, const TransportCatalogue& catalogue);
+
+    TC_routes_table     PackRoutesTable(const RoutesTable& routes_table);
+    std::optional<RoutesTable> UnpackRoutesTable(const TC_routes_table& ser_routes_table);
+
+    TC_contraction_hierarchy PackContractionHierarchy(const ContractionHierarchy& contraction_hierarchy);
+    std::optional<ContractionHierarchy> UnpackContractionHierarchy(const TC_contraction_hierarchy& ser_contraction_hierarchy);
+
+    TC_hub_labels       PackHubLabels(const HubLabels& hub_labels);
+    std::optional<HubLabels> UnpackHubLabels(const TC_hub_labels& ser_hub_labels);
 
     transport_catalogue_serialize::Stop                     PackStop(const Stop& stop);
     transport_catalogue_serialize::Bus                      PackBus(const Bus& bus, const TransportCatalogue& catalogue);
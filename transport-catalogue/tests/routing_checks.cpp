@@ -0,0 +1,449 @@
+//Checks of routing answers that need a whole base: each one builds bases from generated
+//networks, answers the same stat requests over them and compares the answers.
+//Built from the sources of the catalogue without main.cpp, next to the generated protobuf code:
+//  protoc --cpp_out=. *.proto
+//  g++ -std=c++17 -O2 -pthread -I. tests/routing_checks.cpp $(ls *.cpp | grep -v main.cpp) *.pb.cc -lprotobuf -o routing_checks
+//Run from a writable directory, the bases are written there. Exits with 1 if any check fails.
+
+#include "json.h"
+#include "request_handler.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace transport_catalogue;
+
+namespace
+{
+	struct Network
+	{
+		//Stop name -> latitude, longitude, road distances to the other stops
+		struct StopData
+		{
+			double					latitude;
+			double					longitude;
+			map<string, int>		road_distances;
+		};
+		struct BusData
+		{
+			vector<string>			stops;
+			bool					is_roundtrip;
+		};
+
+		map<string, StopData>		stops;
+		map<string, BusData>		buses;
+	};
+
+	string StopName(int index)
+	{
+		return "S"s + to_string(index);
+	}
+
+	Network GenerateNetwork(mt19937& random, int stop_count, int bus_count, int max_bus_stops)
+	{
+		Network network;
+		uniform_real_distribution<double> latitude(55.5, 55.8);
+		uniform_real_distribution<double> longitude(37.4, 37.8);
+		uniform_int_distribution<int> distance(200, 3000);
+		for (int i = 0; i < stop_count; ++i)
+		{
+			network.stops[StopName(i)] = { latitude(random), longitude(random), {} };
+		}
+		uniform_int_distribution<int> stop_index(0, stop_count - 1);
+		uniform_int_distribution<int> bus_length(2, max_bus_stops);
+		for (int i = 0; i < bus_count; ++i)
+		{
+			Network::BusData bus{ {}, random() % 3 == 0 };
+			const int length = bus_length(random);
+			while (static_cast<int>(bus.stops.size()) < length)
+			{
+				const string stop = StopName(stop_index(random));
+				if (find(bus.stops.begin(), bus.stops.end(), stop) == bus.stops.end())
+				{
+					bus.stops.push_back(stop);
+				}
+			}
+			if (bus.is_roundtrip)
+			{
+				bus.stops.push_back(bus.stops.front());
+			}
+			for (size_t j = 0; j + 1 < bus.stops.size(); ++j)
+			{
+				network.stops[bus.stops[j]].road_distances[bus.stops[j + 1]] = distance(random);
+				if (random() % 2 == 0)
+				{
+					network.stops[bus.stops[j + 1]].road_distances[bus.stops[j]] = distance(random);
+				}
+			}
+			network.buses["B"s + to_string(i)] = move(bus);
+		}
+		return network;
+	}
+
+	json::Dict MakeBusRequest(const string& name, const Network::BusData& bus)
+	{
+		json::Array stops(bus.stops.begin(), bus.stops.end());
+		return { {"type"s, "Bus"s}, {"name"s, name}, {"stops"s, move(stops)}, {"is_roundtrip"s, bus.is_roundtrip} };
+	}
+
+	json::Dict MakeBaseDocument(const Network& network, json::Dict routing_settings, const string& filename)
+	{
+		json::Array base_requests;
+		for (const auto& [name, stop] : network.stops)
+		{
+			json::Dict road_distances;
+			for (const auto& [to, distance] : stop.road_distances)
+			{
+				road_distances[to] = distance;
+			}
+			base_requests.push_back(json::Dict{ {"type"s, "Stop"s}, {"name"s, name}, {"latitude"s, stop.latitude},
+				{"longitude"s, stop.longitude}, {"road_distances"s, move(road_distances)} });
+		}
+		for (const auto& [name, bus] : network.buses)
+		{
+			base_requests.push_back(MakeBusRequest(name, bus));
+		}
+		json::Dict render_settings{ {"width"s, 600.0}, {"height"s, 400.0}, {"padding"s, 50.0}, {"stop_radius"s, 5.0},
+			{"line_width"s, 14.0}, {"bus_label_font_size"s, 20}, {"bus_label_offset"s, json::Array{ 7.0, 15.0 }},
+			{"stop_label_font_size"s, 18}, {"stop_label_offset"s, json::Array{ 7.0, -3.0 }},
+			{"underlayer_color"s, json::Array{ 255, 255, 255, 0.85 }}, {"underlayer_width"s, 3.0},
+			{"color_palette"s, json::Array{ "green"s, "red"s }} };
+		return { {"serialization_settings"s, json::Dict{ {"file"s, filename} }}, {"routing_settings"s, move(routing_settings)},
+			{"render_settings"s, move(render_settings)}, {"base_requests"s, move(base_requests)} };
+	}
+
+	stringstream PrintDocument(json::Dict root)
+	{
+		stringstream stream;
+		json::Print(json::Document(json::Node(move(root))), stream);
+		return stream;
+	}
+
+	void MakeBase(const json::Dict& base_document)
+	{
+		TransportCatalogue catalogue;
+		request_handler::RequestHandler request_handler(catalogue);
+		stringstream input = PrintDocument(base_document);
+		request_handler.LoadDataIntoTC(input);
+		Serialize(catalogue, request_handler.GetSerializationFilename());
+	}
+
+	void UpdateBase(const json::Dict& update_document)
+	{
+		TransportCatalogue catalogue;
+		request_handler::RequestHandler request_handler(catalogue);
+		stringstream input = PrintDocument(update_document);
+		request_handler.LoadJsonDocument(input);
+		Deserialize(request_handler.GetSerializationFilename(), catalogue);
+		request_handler.UpdateData();
+		Serialize(catalogue, request_handler.GetSerializationFilename());
+	}
+
+	json::Array ProcessRequests(const string& filename, const json::Array& stat_requests, json::Dict routing_settings = {})
+	{
+		TransportCatalogue catalogue;
+		request_handler::RequestHandler request_handler(catalogue);
+		json::Dict stat_document{ {"serialization_settings"s, json::Dict{ {"file"s, filename} }}, {"stat_requests"s, stat_requests} };
+		if (!routing_settings.empty())
+		{
+			stat_document["routing_settings"s] = move(routing_settings);
+		}
+		stringstream input = PrintDocument(move(stat_document));
+		request_handler.LoadJsonDocument(input);
+		Deserialize(filename, catalogue);
+		stringstream output;
+		request_handler.ProcessRequests(output);
+		return json::Load(output).GetRoot().AsArray();
+	}
+
+	//Route requests between random stops and one Matrix request over a few of them
+	json::Array MakeStatRequests(mt19937& random, int stop_count, int route_count)
+	{
+		json::Array requests;
+		uniform_int_distribution<int> stop_index(0, stop_count - 1);
+		for (int i = 0; i < route_count; ++i)
+		{
+			requests.push_back(json::Dict{ {"id"s, i}, {"type"s, "Route"s}, {"from"s, StopName(stop_index(random))}, {"to"s, StopName(stop_index(random))} });
+		}
+		json::Array origins, destinations;
+		for (int i = 0; i < 10; ++i)
+		{
+			origins.push_back(StopName(stop_index(random)));
+			destinations.push_back(StopName(stop_index(random)));
+		}
+		requests.push_back(json::Dict{ {"id"s, route_count}, {"type"s, "Matrix"s}, {"origins"s, move(origins)}, {"destinations"s, move(destinations)} });
+		return requests;
+	}
+
+	bool AreTimesClose(double expected, double actual, double tolerance)
+	{
+		return abs(expected - actual) <= tolerance * max(1.0, abs(expected));
+	}
+
+	//Answers whose route times differ by more than the relative tolerance, or that differ in
+	//whether a route exists at all
+	int CountMismatches(const json::Array& expected, const json::Array& actual, double tolerance)
+	{
+		int mismatches = 0;
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			const json::Dict& expected_answer = expected[i].AsMap();
+			const json::Dict& actual_answer = actual.at(i).AsMap();
+			if (expected_answer.count("times"s))
+			{
+				const json::Array& expected_times = expected_answer.at("times"s).AsArray();
+				const json::Array& actual_times = actual_answer.at("times"s).AsArray();
+				for (size_t j = 0; j < expected_times.size(); ++j)
+				{
+					if (expected_times[j].IsNull() != actual_times.at(j).IsNull()
+						|| (!expected_times[j].IsNull() && !AreTimesClose(expected_times[j].AsDouble(), actual_times[j].AsDouble(), tolerance)))
+					{
+						++mismatches;
+					}
+				}
+			}
+			else if (expected_answer.count("total_time"s) != actual_answer.count("total_time"s)
+				|| (expected_answer.count("total_time"s)
+					&& !AreTimesClose(expected_answer.at("total_time"s).AsDouble(), actual_answer.at("total_time"s).AsDouble(), tolerance)))
+			{
+				++mismatches;
+			}
+		}
+		return mismatches;
+	}
+
+	//Applies random updates to the network and returns them as "base_updates":
+	//new buses over parts of the existing ones, shorter and longer distances, removed and shortened buses
+	json::Array UpdateNetwork(mt19937& random, Network& network, int update_count)
+	{
+		json::Array updates;
+		const auto pick = [&random](auto& items)
+			{
+				auto it = items.begin();
+				advance(it, random() % items.size());
+				return it;
+			};
+		for (int i = 0; i < update_count; ++i)
+		{
+			const int kind = random() % 10;
+			if (kind < 3)
+			{
+				const vector<string>& stops = pick(network.buses)->second.stops;
+				const size_t begin = random() % (stops.size() - 1);
+				const size_t end = begin + 2 + random() % (stops.size() - begin - 1);
+				const string name = "N"s + to_string(i);
+				network.buses[name] = { vector<string>(stops.begin() + begin, stops.begin() + end), false };
+				updates.push_back(MakeBusRequest(name, network.buses[name]));
+			}
+			else if (kind < 8)
+			{
+				auto stop = pick(network.stops);
+				if (stop->second.road_distances.empty())
+				{
+					continue;
+				}
+				auto road_distance = pick(stop->second.road_distances);
+				road_distance->second = kind < 6 ? max(1, road_distance->second / (2 + static_cast<int>(random() % 4)))
+					: road_distance->second * (2 + static_cast<int>(random() % 4));
+				updates.push_back(json::Dict{ {"type"s, "Distance"s}, {"from"s, stop->first}, {"to"s, road_distance->first},
+					{"distance"s, road_distance->second} });
+			}
+			else if (kind < 9 && network.buses.size() > 1)
+			{
+				auto bus = pick(network.buses);
+				updates.push_back(json::Dict{ {"type"s, "RemoveBus"s}, {"name"s, bus->first} });
+				network.buses.erase(bus);
+			}
+			else
+			{
+				auto bus = pick(network.buses);
+				if (!bus->second.is_roundtrip && bus->second.stops.size() > 2)
+				{
+					bus->second.stops.erase(bus->second.stops.begin());
+				}
+				updates.push_back(MakeBusRequest(bus->first, bus->second));
+			}
+		}
+		return updates;
+	}
+
+	//update_base has to answer Route and Matrix requests as a base built from scratch does
+	bool CheckUpdateMatchesRebuild(const string& graph_model, const string& router_engine, unsigned seed)
+	{
+		mt19937 random(seed);
+		Network network = GenerateNetwork(random, 150, 40, 10);
+		const json::Dict routing_settings{ {"bus_wait_time"s, 4}, {"bus_velocity"s, 37.5}, {"graph_model"s, graph_model},
+			{"router_engine"s, router_engine}, {"precompute_routes"s, router_engine == "all_pairs"s} };
+		const string updated_file = "routing_checks_updated.db"s;
+		const string rebuilt_file = "routing_checks_rebuilt.db"s;
+		const json::Array stat_requests = MakeStatRequests(random, 150, 300);
+
+		MakeBase(MakeBaseDocument(network, routing_settings, updated_file));
+		const json::Array answers_before = ProcessRequests(updated_file, stat_requests);
+		const json::Array updates = UpdateNetwork(random, network, 40);
+		UpdateBase({ {"serialization_settings"s, json::Dict{ {"file"s, updated_file} }}, {"base_updates"s, updates} });
+		MakeBase(MakeBaseDocument(network, routing_settings, rebuilt_file));
+		//Updates that lengthen routes drop the routes table, the updated base has to carry a new one
+		TransportCatalogue updated_catalogue;
+		Deserialize(updated_file, updated_catalogue);
+		const bool keeps_routes_table = router_engine != "all_pairs"s || updated_catalogue.GetRoutesTable().has_value();
+
+		const json::Array updated_answers = ProcessRequests(updated_file, stat_requests);
+		const json::Array rebuilt_answers = ProcessRequests(rebuilt_file, stat_requests);
+		const int mismatches = CountMismatches(rebuilt_answers, updated_answers, 1e-5);
+		const int changed = CountMismatches(answers_before, rebuilt_answers, 1e-5);
+		cerr << "update_base "sv << graph_model << ' ' << router_engine << " seed "sv << seed << ": "sv << mismatches
+			<< " mismatches, "sv << changed << " answers changed by the updates"sv
+			<< (keeps_routes_table ? ""sv : ", the routes table is lost"sv) << endl;
+		//Updates that change nothing wouldn't check anything
+		return mismatches == 0 && changed > 0 && keeps_routes_table;
+	}
+
+	//Route answers whose items don't add up to their total_time
+	int CountInconsistentItems(const json::Array& answers)
+	{
+		int inconsistent = 0;
+		for (const json::Node& answer : answers)
+		{
+			if (!answer.AsMap().count("items"s))
+			{
+				continue;
+			}
+			double items_time = 0;
+			for (const json::Node& item : answer.AsMap().at("items"s).AsArray())
+			{
+				items_time += item.AsMap().at("time"s).AsDouble();
+			}
+			inconsistent += !AreTimesClose(answer.AsMap().at("total_time"s).AsDouble(), items_time, 1e-5);
+		}
+		return inconsistent;
+	}
+
+	//Raptor times rides by the velocity stored in the base, the graph engines by the weights of
+	//the edges built with it: a fractional velocity has to survive the base for them to agree
+	bool CheckRaptorMatchesGraph(const string& graph_model, unsigned seed)
+	{
+		mt19937 random(seed);
+		const Network network = GenerateNetwork(random, 150, 40, 10);
+		const json::Dict routing_settings{ {"bus_wait_time"s, 6}, {"bus_velocity"s, 37.5}, {"graph_model"s, graph_model},
+			{"router_engine"s, "dijkstra"s} };
+		const string file = "routing_checks_raptor.db"s;
+		json::Array stat_requests = MakeStatRequests(random, 150, 300);
+		stat_requests.pop_back();
+
+		MakeBase(MakeBaseDocument(network, routing_settings, file));
+		const json::Array graph_answers = ProcessRequests(file, stat_requests);
+		const json::Array raptor_answers = ProcessRequests(file, stat_requests, { {"router_engine"s, "raptor"s} });
+		const int mismatches = CountMismatches(graph_answers, raptor_answers, 1e-5);
+		const int inconsistent = CountInconsistentItems(graph_answers) + CountInconsistentItems(raptor_answers);
+		cerr << "raptor "sv << graph_model << " seed "sv << seed << ": "sv << mismatches << " mismatches, "sv
+			<< inconsistent << " answers with items not adding up"sv << endl;
+		return mismatches == 0 && inconsistent == 0;
+	}
+
+	//Relative difference allowed between the route times of float and double router weights:
+	//float only picks the route, a tie within its rounding may pick a slightly longer one
+	const double FLOAT_WEIGHTS_TOLERANCE = 1e-4;
+
+	//router_weights "float" has to answer within FLOAT_WEIGHTS_TOLERANCE of "double", with the
+	//base's own settings and with a request's wait time and velocity reweighing the edges
+	bool CheckFloatWeightsMatchDouble(const string& graph_model, const string& router_engine, unsigned seed)
+	{
+		mt19937 random(seed);
+		const Network network = GenerateNetwork(random, 150, 40, 10);
+		const json::Dict routing_settings{ {"bus_wait_time"s, 3}, {"bus_velocity"s, 41.3}, {"graph_model"s, graph_model},
+			{"router_engine"s, router_engine} };
+		const string file = "routing_checks_weights.db"s;
+		json::Array stat_requests = MakeStatRequests(random, 150, 300);
+		for (size_t i = 0; i < stat_requests.size(); i += 2)
+		{
+			json::Dict& request = stat_requests[i].AsMap();
+			request["bus_wait_time"s] = 7;
+			request["bus_velocity"s] = 23.7;
+		}
+
+		MakeBase(MakeBaseDocument(network, routing_settings, file));
+		const json::Array double_answers = ProcessRequests(file, stat_requests, { {"router_weights"s, "double"s} });
+		const json::Array float_answers = ProcessRequests(file, stat_requests, { {"router_weights"s, "float"s} });
+		const int mismatches = CountMismatches(double_answers, float_answers, FLOAT_WEIGHTS_TOLERANCE);
+		const int inconsistent = CountInconsistentItems(float_answers);
+		cerr << "float weights "sv << graph_model << ' ' << router_engine << " seed "sv << seed << ": "sv << mismatches
+			<< " mismatches, "sv << inconsistent << " answers with items not adding up"sv << endl;
+		return mismatches == 0 && inconsistent == 0;
+	}
+
+	//Route requests naming a stop missing from the base are "not found", alone and among
+	//known ones: in the linear model the id of an unknown stop is that of a ride vertex
+	bool CheckUnknownStopsNotFound(const string& graph_model, const string& router_engine)
+	{
+		mt19937 random(1);
+		const Network network = GenerateNetwork(random, 30, 10, 6);
+		const json::Dict routing_settings{ {"bus_wait_time"s, 3}, {"bus_velocity"s, 41.3}, {"graph_model"s, graph_model},
+			{"router_engine"s, router_engine} };
+		const string file = "routing_checks_unknown.db"s;
+		const string known = network.buses.begin()->second.stops.front();
+		json::Array stat_requests;
+		for (const auto& [from, to] : { pair{ known, "Unknown"s }, pair{ "Unknown"s, known }, pair{ "Unknown"s, "Unknown"s } })
+		{
+			stat_requests.push_back(json::Dict{ {"id"s, static_cast<int>(stat_requests.size())}, {"type"s, "Route"s}, {"from"s, from}, {"to"s, to} });
+		}
+
+		MakeBase(MakeBaseDocument(network, routing_settings, file));
+		const json::Array answers = ProcessRequests(file, stat_requests);
+		const int found = count_if(answers.begin(), answers.end(), [](const json::Node& answer)
+			{
+				return answer.AsMap().count("error_message"s) == 0;
+			});
+		cerr << "unknown stops "sv << graph_model << ' ' << router_engine << ": "sv << found << " routes found"sv << endl;
+		return found == 0;
+	}
+}
+
+int main()
+{
+	vector<function<bool()>> checks;
+	for (const string& graph_model : { "pairwise"s, "linear"s })
+	{
+		for (const string& router_engine : { "all_pairs"s, "dijkstra"s, "contraction_hierarchies"s, "hub_labels"s })
+		{
+			for (const unsigned seed : { 1u, 2u })
+			{
+				checks.push_back([=] { return CheckUpdateMatchesRebuild(graph_model, router_engine, seed); });
+			}
+		}
+		for (const unsigned seed : { 1u, 2u })
+		{
+			checks.push_back([=] { return CheckRaptorMatchesGraph(graph_model, seed); });
+		}
+		for (const string& router_engine : { "all_pairs"s, "dijkstra"s })
+		{
+			for (const unsigned seed : { 1u, 2u })
+			{
+				checks.push_back([=] { return CheckFloatWeightsMatchDouble(graph_model, router_engine, seed); });
+			}
+		}
+		for (const string& router_engine : { "all_pairs"s, "dijkstra"s, "contraction_hierarchies"s, "hub_labels"s, "raptor"s })
+		{
+			checks.push_back([=] { return CheckUnknownStopsNotFound(graph_model, router_engine); });
+		}
+	}
+
+	int failed = 0;
+	for (const auto& check : checks)
+	{
+		failed += !check();
+	}
+	cerr << (failed == 0 ? "All checks passed"s : to_string(failed) + " checks failed"s) << endl;
+	return failed == 0 ? 0 : 1;
+}
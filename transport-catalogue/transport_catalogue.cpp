@@ -1,10 +1,20 @@
 #include "transport_catalogue.h"
+#include "parallel.h"
+
+#include <vector>
 
 using namespace std;
 
 namespace transport_catalogue
 {
 	void TransportCatalogue::AddBus(const string& bus_name, const vector<string>& stop_names, bool is_looped)
+	{
+		Bus& deque_bus = *(buses_.insert(buses_.end(), { bus_name, FindStops(stop_names), is_looped, static_cast<BusId>(buses_.size()) }));
+		busnames_to_buses_.insert({ deque_bus.name, &deque_bus });
+		LinkBusToStops(deque_bus);
+	}
+
+	vector<const Stop*> TransportCatalogue::FindStops(const vector<string>& stop_names) const
 	{
 		vector<const Stop*> stops_ptrs;
 		for (const string& stop_name : stop_names)
@@ -15,18 +25,128 @@ namespace transport_catalogue
 			}
 			stops_ptrs.push_back(stopnames_to_stops_.at(stop_name));
 		}
-		Bus& deque_bus = *(buses_.insert(buses_.end(), { bus_name, stops_ptrs, is_looped }));
-		busnames_to_buses_.insert({ deque_bus.name, &deque_bus });
+		return stops_ptrs;
+	}
+
+	void TransportCatalogue::LinkBusToStops(const Bus& bus)
+	{
+		for (const auto& stop : bus.stops)
+		{
+			stopnames_to_busnames_[stop->name].insert(bus.name);
+		}
+	}
+
+	void TransportCatalogue::UnlinkBusFromStops(const Bus& bus)
+	{
+		for (const auto& stop : bus.stops)
+		{
+			stopnames_to_busnames_[stop->name].erase(bus.name);
+		}
+	}
+
+	void TransportCatalogue::UpdateBus(const string& bus_name, const vector<string>& stop_names, bool is_looped)
+	{
+		const auto it = busnames_to_buses_.find(bus_name);
+		if (it == busnames_to_buses_.end())
+		{
+			AddBus(bus_name, stop_names, is_looped);
+		}
+		else
+		{
+			Bus& bus = buses_[it->second->id];
+			UnlinkBusFromStops(bus);
+			bus.stops = FindStops(stop_names);
+			bus.is_looped = is_looped;
+			LinkBusToStops(bus);
+		}
+		if (graph_.IsFrozen() && route_settings_.compact_graph)
+		{
+			RebuildGraph();
+		}
+		else if (graph_.IsFrozen())
+		{
+			ReplaceBusEdges(*busnames_to_buses_.at(bus_name));
+		}
+	}
+
+	void TransportCatalogue::RemoveBus(const string& bus_name)
+	{
+		const auto it = busnames_to_buses_.find(bus_name);
+		if (it == busnames_to_buses_.end())
+		{
+			return;
+		}
+		Bus& bus = buses_[it->second->id];
+		busnames_to_buses_.erase(it);
+		UnlinkBusFromStops(bus);
+		bus.stops.clear();
+		bus.is_removed = true;
+		if (graph_.IsFrozen() && route_settings_.compact_graph)
+		{
+			RebuildGraph();
+		}
+		else if (graph_.IsFrozen())
+		{
+			ReplaceBusEdges(bus);
+		}
+	}
+
+	void TransportCatalogue::UpdateDistance(const string& stop1, const string& stop2, int distance)
+	{
+		stops_distances_.insert_or_assign({ stopnames_to_stops_.at(stop1), stopnames_to_stops_.at(stop2) }, distance * 1.0);
+		if (!graph_.IsFrozen())
+		{
+			return;
+		}
+		if (route_settings_.compact_graph)
+		{
+			RebuildGraph();
+			return;
+		}
 
-		for (const auto& stop : deque_bus.stops)
+		//Only the buses that pass both stops use the distance, and their edges keep their places
+		const auto first_stop_buses = stopnames_to_busnames_.find(stop1);
+		const auto second_stop_buses = stopnames_to_busnames_.find(stop2);
+		if (first_stop_buses == stopnames_to_busnames_.end() || second_stop_buses == stopnames_to_busnames_.end())
 		{
-			stopnames_to_busnames_[stop->name].insert(bus_name);
+			return;
 		}
+		vector<graph::EdgeId> cheaper_edges;
+		bool routes_may_lengthen = false;
+		for (const string& bus_name : first_stop_buses->second)
+		{
+			if (!second_stop_buses->second.count(bus_name))
+			{
+				continue;
+			}
+			const Bus& bus = *busnames_to_buses_.at(bus_name);
+			const EdgeRange& range = bus_edge_ranges_[bus.id];
+			//A linear bus starts with the boarding edge to its first ride vertex
+			const graph::VertexId first_ride_vertex = route_settings_.graph_model == GraphModel::LINEAR && range.count != 0 ? graph_.GetEdge(range.first).to : 0;
+			const vector<graph::Edge<double>> edges = MakeBusEdges(bus, first_ride_vertex);
+			for (size_t i = 0; i != edges.size(); ++i)
+			{
+				const graph::EdgeId edge_id = range.first + i;
+				const double old_weight = graph_.GetEdge(edge_id).weight;
+				if (edges[i].weight < old_weight)
+				{
+					cheaper_edges.push_back(edge_id);
+				}
+				else if (edges[i].weight > old_weight)
+				{
+					routes_may_lengthen = true;
+				}
+				graph_.SetEdgeWeight(edge_id, edges[i].weight);
+				//Items of a route and reweighed settings are computed from the distance
+				graph_.SetEdgeDistance(edge_id, edges[i].distance);
+			}
+		}
+		RepairRoutingData(cheaper_edges, routes_may_lengthen);
 	}
 
 	void TransportCatalogue::AddStop(const string& stop_name, coordinates::Coordinates coordinates)
 	{
-		Stop& deque_stop = *(stops_.insert(stops_.end(), { stop_name, coordinates }));
+		Stop& deque_stop = *(stops_.insert(stops_.end(), { stop_name, coordinates, static_cast<StopId>(stops_.size()) }));
 		stopnames_to_stops_.insert({ deque_stop.name, &deque_stop });
 	}
 
@@ -44,13 +164,18 @@ namespace transport_catalogue
 		return coordinates::ComputeDistance(stopnames_to_stops_.at(stop1)->coordinates, stopnames_to_stops_.at(stop2)->coordinates);
 	}
 
-	double TransportCatalogue::GetRealDistance(const string& stop1, const string& stop2)
+	double TransportCatalogue::GetRealDistance(const string& stop1, const string& stop2) const
+	{
+		return GetRealDistance(stopnames_to_stops_.at(stop1), stopnames_to_stops_.at(stop2));
+	}
+
+	double TransportCatalogue::GetRealDistance(const Stop* stop1, const Stop* stop2) const
 	{
-		if (stops_distances_.count({ stopnames_to_stops_.at(stop1), stopnames_to_stops_.at(stop2) }))
+		if (const auto it = stops_distances_.find({ stop1, stop2 }); it != stops_distances_.end())
 		{
-			return stops_distances_.at({ stopnames_to_stops_.at(stop1), stopnames_to_stops_.at(stop2) });
+			return it->second;
 		}
-		return stops_distances_.at({ stopnames_to_stops_.at(stop2), stopnames_to_stops_.at(stop1) });
+		return stops_distances_.at({ stop2, stop1 });
 	}
 
 	double TransportCatalogue::GetGeoRouteDistance(const Bus& bus)
@@ -72,13 +197,13 @@ namespace transport_catalogue
 		double result = 0;
 		for (size_t i = 0; i < bus.stops.size() - 1; ++i)
 		{
-			result += GetRealDistance(bus.stops[i]->name, bus.stops[i + 1]->name);
+			result += GetRealDistance(bus.stops[i], bus.stops[i + 1]);
 		}
 		if (!bus.is_looped)
 		{
 			for (size_t i = 0; i < bus.stops.size() - 1; ++i)
 			{
-				result += GetRealDistance(bus.stops[i + 1]->name, bus.stops[i]->name);
+				result += GetRealDistance(bus.stops[i + 1], bus.stops[i]);
 			}
 		}
 		return result;
@@ -148,13 +273,13 @@ namespace transport_catalogue
 		for (size_t i = 0; i < bus.stops.size() - 1; ++i)
 		{
 			geo_distance += coordinates::ComputeDistance(bus.stops[i]->coordinates, bus.stops[i + 1]->coordinates);
-			real_distance += this->GetRealDistance(bus.stops[i]->name, bus.stops[i + 1]->name);
+			real_distance += this->GetRealDistance(bus.stops[i], bus.stops[i + 1]);
 		}
 		if (!bus.is_looped)
 		{
 			for (size_t i = 0; i < bus.stops.size() - 1; ++i)
 			{
-				real_distance += this->GetRealDistance(bus.stops[i + 1]->name, bus.stops[i]->name);
+				real_distance += this->GetRealDistance(bus.stops[i + 1], bus.stops[i]);
 			}
 			geo_distance *= 2;
 		}
@@ -181,36 +306,218 @@ namespace transport_catalogue
 
 	void TransportCatalogue::BuildGraph()
 	{
-		graph_ = graph::DirectedWeightedGraph<double>(stops_.size());
-		for (const Bus& bus : buses_)
+		//Stop vertices go first, so that a stop's vertex id is still its index,
+		//the linear model then gives every bus direction a run of ride vertices
+		vector<graph::VertexId> first_ride_vertices(buses_.size());
+		graph::VertexId vertex_count = stops_.size();
+		if (route_settings_.graph_model == GraphModel::LINEAR)
+		{
+			for (const Bus& bus : buses_)
+			{
+				first_ride_vertices[bus.id] = vertex_count;
+				vertex_count += bus.stops.size() * (bus.is_looped ? 1 : 2);
+			}
+		}
+
+		//Buses are independent, so their edges are made in parallel, and then
+		//added in bus order: edge ids don't depend on the number of threads
+		vector<vector<graph::Edge<double>>> bus_edges(buses_.size());
+		parallel::ForEachIndex(buses_.size(), parallel::ResolveThreadCount(route_settings_.graph_threads), [&](size_t bus_index)
+			{
+				bus_edges[bus_index] = MakeBusEdges(buses_[bus_index], first_ride_vertices[bus_index]);
+			});
+
+		graph_ = graph::DirectedWeightedGraph<double>(vertex_count);
+		bus_edge_ranges_.assign(buses_.size(), {});
+		for (size_t bus_index = 0; bus_index != buses_.size(); ++bus_index)
+		{
+			bus_edge_ranges_[bus_index] = { graph_.GetEdgeCount(), bus_edges[bus_index].size() };
+			for (const graph::Edge<double>& edge : bus_edges[bus_index])
+			{
+				graph_.AddEdge(edge);
+			}
+			vector<graph::Edge<double>>().swap(bus_edges[bus_index]);
+		}
+		if (route_settings_.compact_graph)
+		{
+			RemoveDominatedEdges();
+		}
+		//The graph isn't changed after it's built, routers walk its compressed rows
+		graph_.Freeze();
+	}
+
+	void TransportCatalogue::RemoveDominatedEdges()
+	{
+		//Parallel edges leave the same vertex, so they board with the same wait and compare
+		//by distance alike under any settings. Lower ids come first in the incidence lists
+		vector<graph::EdgeId> shortest_edges(graph_.GetVertexCount(), graph_.GetEdgeCount());
+		vector<graph::VertexId> targets;
+		vector<graph::EdgeId> dominated_edges;
+		for (graph::VertexId vertex = 0; vertex != graph_.GetVertexCount(); ++vertex)
+		{
+			for (graph::EdgeId edge_id : graph_.GetIncidentEdges(vertex))
+			{
+				const graph::Edge<double>& edge = graph_.GetEdge(edge_id);
+				graph::EdgeId& shortest_edge = shortest_edges[edge.to];
+				if (shortest_edge == graph_.GetEdgeCount())
+				{
+					shortest_edge = edge_id;
+					targets.push_back(edge.to);
+				}
+				else if (edge.distance < graph_.GetEdge(shortest_edge).distance)
+				{
+					dominated_edges.push_back(shortest_edge);
+					shortest_edge = edge_id;
+				}
+				else
+				{
+					dominated_edges.push_back(edge_id);
+				}
+			}
+			for (graph::VertexId target : targets)
+			{
+				shortest_edges[target] = graph_.GetEdgeCount();
+			}
+			targets.clear();
+		}
+		graph_.RemoveEdges(dominated_edges);
+	}
+
+	void TransportCatalogue::RebuildGraph()
+	{
+		BuildGraph();
+		routes_table_.reset();
+		contraction_hierarchy_.reset();
+		hub_labels_.reset();
+	}
+
+	vector<graph::Edge<double>> TransportCatalogue::MakeBusEdges(const Bus& bus, graph::VertexId first_ride_vertex) const
+	{
+		vector<graph::Edge<double>> edges;
+		if (route_settings_.graph_model == GraphModel::LINEAR)
+		{
+			MakeLinearBusEdges(bus, first_ride_vertex, edges);
+		}
+		else
 		{
-			size_t left_bus_stop_count = bus.stops.size();
-			for (size_t i = 0; i != left_bus_stop_count; ++i)
+			MakePairwiseBusEdges(bus, edges);
+		}
+		return edges;
+	}
+
+	void TransportCatalogue::MakePairwiseBusEdges(const Bus& bus, vector<graph::Edge<double>>& edges) const
+	{
+		const EdgeWeigher weigher = GetEdgeWeigher(route_settings_);
+		size_t left_bus_stop_count = bus.stops.size();
+		for (size_t i = 0; i != left_bus_stop_count; ++i)
+		{
+			const Stop* first_stop_iter = bus.stops[i];
+			graph::VertexId first_stop_id = first_stop_iter->id;
+			double forward_distance = 0;
+			double backwards_distance = 0;
+			for (size_t j = i + 1; j != left_bus_stop_count; ++j)
 			{
-				const Stop* first_stop_iter = bus.stops[i];
-				graph::EdgeId first_stop_id = distance(stops_.begin(), find(stops_.begin(), stops_.end(), *first_stop_iter));
-				double forward_distance = 0;
-				double backwards_distance = 0;
-				for (size_t j = i + 1; j != left_bus_stop_count; ++j)
+				const Stop* second_stop_iter = bus.stops[j];
+				const Stop* prev_second_stop_iter = bus.stops[j - 1];
+				forward_distance += GetRealDistance(prev_second_stop_iter, second_stop_iter);
+				graph::VertexId second_stop_id = second_stop_iter->id;
+
+				graph::Edge<double> forward_edge{ first_stop_id, second_stop_id, (static_cast<uint32_t>(j) - static_cast<uint32_t>(i)), bus.id, 0.0, forward_distance };
+				forward_edge.weight = weigher(forward_edge);
+				edges.push_back(forward_edge);
+				if (!bus.is_looped)
 				{
-					const Stop* second_stop_iter = bus.stops[j];
-					const Stop* prev_second_stop_iter = bus.stops[j - 1];
-					forward_distance += GetRealDistance(prev_second_stop_iter->name, second_stop_iter->name);
-					graph::EdgeId second_stop_id = distance(stops_.begin(), find(stops_.begin(), stops_.end(), *second_stop_iter));
-
-					graph_.AddEdge
-						({ first_stop_id, second_stop_id, (static_cast<uint32_t>(j) - static_cast<uint32_t>(i)), bus.name, route_settings_.bus_wait_time + forward_distance / route_settings_.bus_velocity * 60 / 1000 });
-					if (!bus.is_looped)
-					{
-						backwards_distance += GetRealDistance(second_stop_iter->name, prev_second_stop_iter->name);
-						graph_.AddEdge
-							({ second_stop_id, first_stop_id, (static_cast<uint32_t>(j) - static_cast<uint32_t>(i)), bus.name, route_settings_.bus_wait_time + backwards_distance / route_settings_.bus_velocity * 60 / 1000 });
-					}
+					backwards_distance += GetRealDistance(second_stop_iter, prev_second_stop_iter);
+					graph::Edge<double> backwards_edge{ second_stop_id, first_stop_id, (static_cast<uint32_t>(j) - static_cast<uint32_t>(i)), bus.id, 0.0, backwards_distance };
+					backwards_edge.weight = weigher(backwards_edge);
+					edges.push_back(backwards_edge);
 				}
 			}
 		}
 	}
 
+	void TransportCatalogue::MakeLinearBusEdges(const Bus& bus, graph::VertexId first_ride_vertex, vector<graph::Edge<double>>& edges) const
+	{
+		AddRideChain(bus.id, bus.stops, first_ride_vertex, edges);
+		if (!bus.is_looped)
+		{
+			AddRideChain(bus.id, vector<const Stop*>(bus.stops.rbegin(), bus.stops.rend()), first_ride_vertex + bus.stops.size(), edges);
+		}
+	}
+
+	void TransportCatalogue::AddRideChain(graph::BusId bus_id, const vector<const Stop*>& stops, graph::VertexId first_ride_vertex, vector<graph::Edge<double>>& edges) const
+	{
+		const EdgeWeigher weigher = GetEdgeWeigher(route_settings_);
+		auto add_edge = [&edges, &weigher](graph::Edge<double> edge)
+		{
+			edge.weight = weigher(edge);
+			edges.push_back(edge);
+		};
+		for (size_t i = 0; i != stops.size(); ++i)
+		{
+			const graph::VertexId stop_vertex = stops[i]->id;
+			const graph::VertexId ride_vertex = first_ride_vertex + i;
+			add_edge({ stop_vertex, ride_vertex, 0, bus_id, 0.0, 0.0 });
+			add_edge({ ride_vertex, stop_vertex, 0, bus_id, 0.0, 0.0 });
+			if (i != 0)
+			{
+				add_edge({ ride_vertex - 1, ride_vertex, 1, bus_id, 0.0, GetRealDistance(stops[i - 1], stops[i]) });
+			}
+		}
+	}
+
+	void TransportCatalogue::ReplaceBusEdges(const Bus& bus)
+	{
+		if (bus_edge_ranges_.size() <= bus.id)
+		{
+			bus_edge_ranges_.resize(bus.id + 1);
+		}
+		EdgeRange& range = bus_edge_ranges_[bus.id];
+		const bool routes_may_lengthen = range.count != 0;
+
+		graph_.Thaw();
+		for (graph::EdgeId edge_id = range.first; edge_id != range.first + range.count; ++edge_id)
+		{
+			graph_.RemoveEdge(edge_id);
+		}
+		//The old ride vertices of a linear bus are left isolated
+		graph::VertexId first_ride_vertex = 0;
+		if (route_settings_.graph_model == GraphModel::LINEAR)
+		{
+			first_ride_vertex = graph_.AddVertices(bus.stops.size() * (bus.is_looped ? 1 : 2));
+		}
+		vector<graph::EdgeId> inserted_edges;
+		for (const graph::Edge<double>& edge : MakeBusEdges(bus, first_ride_vertex))
+		{
+			inserted_edges.push_back(graph_.AddEdge(edge));
+		}
+		range = { inserted_edges.empty() ? 0 : inserted_edges.front(), inserted_edges.size() };
+		graph_.Freeze();
+
+		RepairRoutingData(inserted_edges, routes_may_lengthen);
+	}
+
+	void TransportCatalogue::RepairRoutingData(const vector<graph::EdgeId>& inserted_edges, bool routes_may_lengthen)
+	{
+		if (inserted_edges.empty() && !routes_may_lengthen)
+		{
+			return;
+		}
+		contraction_hierarchy_.reset();
+		hub_labels_.reset();
+		if (!routes_table_)
+		{
+			return;
+		}
+		//Serialize builds the table over again for a base made with precompute_routes
+		if (routes_may_lengthen)
+		{
+			routes_table_.reset();
+			return;
+		}
+		graph::Router<double>::InsertEdges(graph_, *routes_table_, inserted_edges, route_settings_.router_threads);
+	}
+
 	void TransportCatalogue::AddRouteSettings(RouteSettings route_settings)
 	{
 		route_settings_ = route_settings;
@@ -218,8 +525,8 @@ namespace transport_catalogue
 
 	graph::VertexId TransportCatalogue::GetVertexId(std::string_view stop_name) const
 	{
-		std::deque<transport_catalogue::Stop>::const_iterator needed_stop = find_if(stops_.begin(), stops_.end(), [stop_name](const Stop& stop) {return stop.name == stop_name; });
-		return distance(stops_.begin(), needed_stop);
+		const auto it = stopnames_to_stops_.find(std::string(stop_name));
+		return it != stopnames_to_stops_.end() ? it->second->id : stops_.size();
 	}
 
 	const graph::DirectedWeightedGraph<double>& TransportCatalogue::GetGraph() const
@@ -232,28 +539,35 @@ namespace transport_catalogue
 		return route_settings_;
 	}
 
+	EdgeWeigher TransportCatalogue::GetEdgeWeigher(const RouteSettings& route_settings) const
+	{
+		return { stops_.size(), route_settings.bus_wait_time, route_settings.bus_velocity };
+	}
+
 	const string& TransportCatalogue::GetFirstStopByEdgeId(graph::EdgeId id) const
 	{
-		graph::Edge edge = graph_.GetEdge(id);
+		const graph::Edge<double>& edge = graph_.GetEdge(id);
 		return stops_.at(edge.from).name;
 	}
 
-	const string TransportCatalogue::GetBusNameByEdgeId(graph::EdgeId id) const
+	const string& TransportCatalogue::GetBusNameByEdgeId(graph::EdgeId id) const
+	{
+		return GetBusName(graph_.GetEdge(id).bus_id);
+	}
+
+	const string& TransportCatalogue::GetBusName(graph::BusId bus_id) const
 	{
-		graph::Edge edge = graph_.GetEdge(id);
-		return edge.bus_name;
+		return buses_.at(bus_id).name;
 	}
 
 	double TransportCatalogue::GetEdgeWeightByEdgeId(graph::EdgeId id) const
 	{
-		graph::Edge edge = graph_.GetEdge(id);
-		return edge.weight;
+		return graph_.GetEdge(id).weight;
 	}
 
 	uint32_t TransportCatalogue::GetSpanCountByEdgeId(graph::EdgeId id) const
 	{
-		graph::Edge edge = graph_.GetEdge(id);
-		return edge.span_count;
+		return graph_.GetEdge(id).span_count;
 	}
 
 	const std::deque<Stop>& TransportCatalogue::GetStops() const
@@ -273,11 +587,10 @@ namespace transport_catalogue
 
 	size_t TransportCatalogue::GetStopIndex(const Stop* stop) const
 	{
-		auto it = find(stops_.begin(), stops_.end(), *stop);
-		return distance(stops_.begin(), it);
+		return stop->id;
 	}
 
-	std::string TransportCatalogue::GetStopnameByIndex(size_t index) const
+	const std::string& TransportCatalogue::GetStopnameByIndex(size_t index) const
 	{
 		return stops_.at(index).name;
 	}
@@ -294,6 +607,52 @@ namespace transport_catalogue
 
 	void TransportCatalogue::SetGraph(graph::DirectedWeightedGraph<double> graph)
 	{
-		graph_ = graph;
+		graph_ = std::move(graph);
+		graph_.Freeze();
+
+		bus_edge_ranges_.assign(buses_.size(), {});
+		for (graph::EdgeId edge_id = 0; edge_id != graph_.GetEdgeCount(); ++edge_id)
+		{
+			if (graph_.IsEdgeRemoved(edge_id))
+			{
+				continue;
+			}
+			EdgeRange& range = bus_edge_ranges_.at(graph_.GetEdge(edge_id).bus_id);
+			if (range.count == 0)
+			{
+				range.first = edge_id;
+			}
+			range.count = edge_id - range.first + 1;
+		}
+	}
+
+	void TransportCatalogue::SetRoutesTable(RoutesTable routes_table)
+	{
+		routes_table_ = std::move(routes_table);
+	}
+
+	const std::optional<TransportCatalogue::RoutesTable>& TransportCatalogue::GetRoutesTable() const
+	{
+		return routes_table_;
+	}
+
+	void TransportCatalogue::SetContractionHierarchy(ContractionHierarchyPtr contraction_hierarchy)
+	{
+		contraction_hierarchy_ = std::move(contraction_hierarchy);
+	}
+
+	const TransportCatalogue::ContractionHierarchyPtr& TransportCatalogue::GetContractionHierarchy() const
+	{
+		return contraction_hierarchy_;
+	}
+
+	void TransportCatalogue::SetHubLabels(HubLabelsPtr hub_labels)
+	{
+		hub_labels_ = std::move(hub_labels);
+	}
+
+	const TransportCatalogue::HubLabelsPtr& TransportCatalogue::GetHubLabels() const
+	{
+		return hub_labels_;
 	}
 }// namespace transport_catalogue
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "geo.h"
 #include "domain.h"
 #include "router.h"
+#include "contraction_hierarchy.h"
+#include "hub_labels.h"
 #include "graph.h"
 #include "map_renderer.h"
 
@@ -13,6 +15,7 @@
 #include <deque>
 #include <vector>
 #include <optional>
+#include <memory>
 
 namespace transport_catalogue
 {
@@ -31,21 +34,45 @@ namespace transport_catalogue
 	}
 
 
+	//Edge weight in minutes under the given settings: a wait for every boarding plus the ride
+	struct EdgeWeigher
+	{
+		//Stop vertices go first, and only the edges leaving them board a bus
+		size_t stop_count;
+		int bus_wait_time;
+		double bus_velocity;
+
+		double operator()(const graph::Edge<double>& edge) const
+		{
+			return (edge.from < stop_count ? bus_wait_time : 0) + edge.distance / bus_velocity * 60 / 1000;
+		}
+	};
+
 	class TransportCatalogue
 	{
 	public:
 		using Stop_distances_Hash = std::unordered_map<std::pair<const Stop*, const Stop*>, double, detail::StopsHasher>;
+		using RoutesTable = graph::Router<double>::RoutesTable;
+		using ContractionHierarchyPtr = std::shared_ptr<const graph::ContractionHierarchy<double>>;
+		using HubLabelsPtr = std::shared_ptr<const graph::HubLabels<double>>;
 
 		void										AddBus(const std::string& bus_name, const std::vector<std::string>& stop_names, bool is_looped);
 		void                                        AddStop(const std::string& stop_name, coordinates::Coordinates coordinates);
 		void                                        AddDistance(const std::string& stop1, const std::string& stop2, int distance);
 		void										AddRouteSettings(RouteSettings route_settings);
 
+		//Once the graph is built, these patch only the edges of the affected buses
+		//and repair the precomputed routes instead of building them again
+		void										UpdateBus(const std::string& bus_name, const std::vector<std::string>& stop_names, bool is_looped);
+		void										RemoveBus(const std::string& bus_name);
+		void										UpdateDistance(const std::string& stop1, const std::string& stop2, int distance);
+
 		const Bus&                                  FindBus(const std::string& name);
 		const Stop&                                 FindStop(const std::string& name);
 
 		double                                      GetGeoDistance(const std::string& stop1, const std::string& stop2);
-		double                                      GetRealDistance(const std::string& stop1, const std::string& stop2);
+		double                                      GetRealDistance(const std::string& stop1, const std::string& stop2) const;
+		double                                      GetRealDistance(const Stop* stop1, const Stop* stop2) const;
 		double                                      GetGeoRouteDistance(const Bus& bus);
 		double                                      GetRealRouteDistance(const Bus& bus);
 		std::set<std::string>                       GetBusesByStop(const Stop& stop);
@@ -57,9 +84,12 @@ namespace transport_catalogue
 		const graph::DirectedWeightedGraph<double>& GetGraph() const;
 		graph::VertexId								GetVertexId(std::string_view stop_name) const;
 		const RouteSettings&						GetRouteSettings() const;
+		EdgeWeigher									GetEdgeWeigher(const RouteSettings& route_settings) const;
 
 		const std::string&							GetFirstStopByEdgeId(graph::EdgeId id) const;
-		const std::string							GetBusNameByEdgeId(graph::EdgeId id) const;
+		const std::string&							GetBusNameByEdgeId(graph::EdgeId id) const;
+		//Buses are numbered in insertion order, graph edges refer to them by this id
+		const std::string&							GetBusName(graph::BusId bus_id) const;
 		double										GetEdgeWeightByEdgeId(graph::EdgeId id) const;
 		uint32_t									GetSpanCountByEdgeId(graph::EdgeId id) const;
 
@@ -70,17 +100,51 @@ namespace transport_catalogue
 		const std::deque<Bus>&						GetBuses() const;
 		const Stop_distances_Hash&					GetDistances() const;
 		size_t										GetStopIndex(const Stop* stop) const;
-		std::string									GetStopnameByIndex(size_t index) const;
+		const std::string&							GetStopnameByIndex(size_t index) const;
 		void 										SetRenderSettings(map_renderer::RenderSettings settings);
 		const map_renderer::RenderSettings& 		GetRenderSettings() const;
 		void 										SetGraph(graph::DirectedWeightedGraph<double> graph);
+		void										SetRoutesTable(RoutesTable routes_table);
+		const std::optional<RoutesTable>&			GetRoutesTable() const;
+		void										SetContractionHierarchy(ContractionHierarchyPtr contraction_hierarchy);
+		const ContractionHierarchyPtr&				GetContractionHierarchy() const;
+		void										SetHubLabels(HubLabelsPtr hub_labels);
+		const HubLabelsPtr&							GetHubLabels() const;
 
 	private:
+		struct EdgeRange
+		{
+			graph::EdgeId first = 0;
+			size_t count = 0;
+		};
+
+		std::vector<const Stop*>					FindStops(const std::vector<std::string>& stop_names) const;
+		void										LinkBusToStops(const Bus& bus);
+		void										UnlinkBusFromStops(const Bus& bus);
+
+		std::vector<graph::Edge<double>>			MakeBusEdges(const Bus& bus, graph::VertexId first_ride_vertex) const;
+		void										MakePairwiseBusEdges(const Bus& bus, std::vector<graph::Edge<double>>& edges) const;
+		void										MakeLinearBusEdges(const Bus& bus, graph::VertexId first_ride_vertex, std::vector<graph::Edge<double>>& edges) const;
+		//Boarding, alighting and riding edges of one direction of a bus
+		void										AddRideChain(graph::BusId bus_id, const std::vector<const Stop*>& stops, graph::VertexId first_ride_vertex, std::vector<graph::Edge<double>>& edges) const;
+		void										ReplaceBusEdges(const Bus& bus);
+		//Of the edges between the same two vertices keeps the shortest one, the first of equal ones
+		void										RemoveDominatedEdges();
+		//Builds the graph anew and drops the routing data built over the old one
+		void										RebuildGraph();
+		//Drops what can't be repaired: the hierarchy and the hub labels always, the routes table if a route may get longer
+		void										RepairRoutingData(const std::vector<graph::EdgeId>& inserted_edges, bool routes_may_lengthen);
+
 		std::deque<Bus>												buses_;
 		std::deque<Stop>											stops_;
 		RouteSettings												route_settings_;
 		graph::DirectedWeightedGraph<double>						graph_;
 		map_renderer::RenderSettings 								render_settings_;
+		std::optional<RoutesTable>									routes_table_;
+		ContractionHierarchyPtr										contraction_hierarchy_;
+		HubLabelsPtr												hub_labels_;
+		//Edges of a bus are added together, so they are a single run of ids
+		std::vector<EdgeRange>										bus_edge_ranges_;
 
 		std::map<std::string, const Bus*>							busnames_to_buses_;
 		std::unordered_map<std::string, const Stop*>				stopnames_to_stops_;
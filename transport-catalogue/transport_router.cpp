@@ -0,0 +1,468 @@
+#include "transport_router.h"
+#include "router.h"
+#include "dijkstra_router.h"
+#include "contraction_hierarchy.h"
+#include "isochrone.h"
+#include "bidirectional_dijkstra.h"
+#include "pruned_router.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+namespace transport_catalogue
+{
+	namespace transport_router
+	{
+		RouterEngine ParseRouterEngine(string_view engine_name)
+		{
+			if (engine_name == "all_pairs"sv)
+			{
+				return RouterEngine::ALL_PAIRS;
+			}
+			if (engine_name == "dijkstra"sv)
+			{
+				return RouterEngine::DIJKSTRA;
+			}
+			if (engine_name == "contraction_hierarchies"sv)
+			{
+				return RouterEngine::CONTRACTION_HIERARCHIES;
+			}
+			if (engine_name == "raptor"sv)
+			{
+				return RouterEngine::RAPTOR;
+			}
+			if (engine_name == "bidirectional_dijkstra"sv)
+			{
+				return RouterEngine::BIDIRECTIONAL_DIJKSTRA;
+			}
+			if (engine_name == "bidirectional_astar"sv)
+			{
+				return RouterEngine::BIDIRECTIONAL_ASTAR;
+			}
+			if (engine_name == "hub_labels"sv)
+			{
+				return RouterEngine::HUB_LABELS;
+			}
+			throw invalid_argument("Unknown router engine: "s + string(engine_name));
+		}
+
+		bool FitsMemoryBudget(size_t bytes, const RouteSettings& settings)
+		{
+			return settings.router_memory_budget == 0 || bytes <= settings.router_memory_budget;
+		}
+
+		graph::HubLabels<double> BuildHubLabels(const graph::DirectedWeightedGraph<double>& graph)
+		{
+			const auto start = chrono::steady_clock::now();
+			graph::HubLabels<double> hub_labels = graph::BuildHubLabels(graph);
+			const auto build_time = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+			clog << "hub_labels: "sv << hub_labels.GetEntryCount() << " entries over "sv << graph.GetVertexCount() << " vertices, "sv
+				<< hub_labels.GetMemoryUsage() << " bytes, built in "sv << build_time.count() << " ms"sv << endl;
+			return hub_labels;
+		}
+
+		namespace
+		{
+			//Shortest-path trees the budget has room for
+			template <typename Weight>
+			size_t GetMemoizedTreesLimit(const graph::DirectedWeightedGraph<Weight>& graph, const RouteSettings& settings)
+			{
+				if (settings.router_memory_budget == 0)
+				{
+					return graph::DijkstraRouter<Weight>::UNLIMITED_TREES;
+				}
+				return settings.router_memory_budget / max<size_t>(1, graph::DijkstraRouter<Weight>::EstimateTreeMemoryUsage(graph.GetVertexCount()));
+			}
+
+			//The all-pairs router, or a DijkstraRouter over the same graph, whose weights are narrowed to Weight
+			template <typename Weight>
+			RouterPtr MakePrunedRouter(const graph::DirectedWeightedGraph<double>& graph, const RouteSettings& settings, bool all_pairs,
+				const graph::PrunedRouter<double>::EdgeWeigher& edge_weigher)
+			{
+				using CompactGraph = graph::DirectedWeightedGraph<Weight>;
+				return make_unique<graph::PrunedRouter<double, Weight>>(graph, [&settings, all_pairs](const CompactGraph& compact_graph)
+					-> unique_ptr<graph::RouterBase<Weight>>
+					{
+						if (!all_pairs)
+						{
+							return make_unique<graph::DijkstraRouter<Weight>>(compact_graph, GetMemoizedTreesLimit(compact_graph, settings));
+						}
+						//Only the routable vertices get rows and columns of the table
+						if (const size_t table_size = graph::Router<Weight>::EstimateMemoryUsage(compact_graph.GetVertexCount()); !FitsMemoryBudget(table_size, settings))
+						{
+							const size_t trees_limit = GetMemoizedTreesLimit(compact_graph, settings);
+							clog << "all_pairs: the routes table needs "sv << table_size << " bytes, router_memory_budget is "sv << settings.router_memory_budget
+								<< "; routing with dijkstra, memoizing up to "sv << trees_limit << " trees"sv << endl;
+							return make_unique<graph::DijkstraRouter<Weight>>(compact_graph, trees_limit);
+						}
+						return make_unique<graph::Router<Weight>>(compact_graph, settings.router_threads);
+					}, edge_weigher);
+			}
+
+			//The weigher, if any, is applied while the graph is compacted, so the search reads plain weights
+			RouterPtr MakePrunedRouter(const graph::DirectedWeightedGraph<double>& graph, const RouteSettings& settings, bool all_pairs,
+				const graph::PrunedRouter<double>::EdgeWeigher& edge_weigher = {})
+			{
+				if (settings.router_weights == RouterWeights::FLOAT)
+				{
+					return MakePrunedRouter<float>(graph, settings, all_pairs, edge_weigher);
+				}
+				return MakePrunedRouter<double>(graph, settings, all_pairs, edge_weigher);
+			}
+
+			//Minutes it takes to cover the great-circle distance between the stops of two vertices at
+			//bus_velocity, no wait included. A ride vertex lies at the stop its alighting edge leads to
+			graph::BidirectionalDijkstraRouter<double>::LowerBound MakeGeoLowerBound(const TransportCatalogue& catalogue, const RouteSettings& settings)
+			{
+				const graph::DirectedWeightedGraph<double>& graph = catalogue.GetGraph();
+				const deque<Stop>& stops = catalogue.GetStops();
+				auto vertex_coordinates = make_shared<vector<optional<coordinates::Coordinates>>>(graph.GetVertexCount());
+				for (graph::VertexId vertex = 0; vertex != graph.GetVertexCount(); ++vertex)
+				{
+					if (vertex < stops.size())
+					{
+						(*vertex_coordinates)[vertex] = stops[vertex].coordinates;
+						continue;
+					}
+					graph.ForEachIncidentEdge(vertex, [&](graph::EdgeId, graph::VertexId to, double)
+						{
+							if (to < stops.size())
+							{
+								(*vertex_coordinates)[vertex] = stops[to].coordinates;
+							}
+						});
+				}
+				const double minutes_per_meter = 60.0 / 1000 / settings.bus_velocity;
+				return [vertex_coordinates, minutes_per_meter](graph::VertexId from, graph::VertexId to)
+					{
+						const optional<coordinates::Coordinates>& from_coordinates = (*vertex_coordinates)[from];
+						const optional<coordinates::Coordinates>& to_coordinates = (*vertex_coordinates)[to];
+						if (!from_coordinates || !to_coordinates)
+						{
+							return 0.0;
+						}
+						//acos of a rounded cosine may give nan for stops next to each other
+						const double distance = coordinates::ComputeDistance(*from_coordinates, *to_coordinates);
+						return isnan(distance) ? 0.0 : distance * minutes_per_meter;
+					};
+			}
+
+			RouterPtr MakeBidirectionalRouter(const TransportCatalogue& catalogue, const RouteSettings& settings)
+			{
+				const RouteSettings& base_settings = catalogue.GetRouteSettings();
+				graph::BidirectionalDijkstraRouter<double>::EdgeWeigher edge_weigher;
+				if (settings.bus_wait_time != base_settings.bus_wait_time || settings.bus_velocity != base_settings.bus_velocity)
+				{
+					edge_weigher = catalogue.GetEdgeWeigher(settings);
+				}
+				return make_unique<graph::BidirectionalDijkstraRouter<double>>(catalogue.GetGraph(),
+					settings.router_engine == RouterEngine::BIDIRECTIONAL_ASTAR ? MakeGeoLowerBound(catalogue, settings) : nullptr, edge_weigher);
+			}
+		}
+
+		RouterPtr MakeRouter(const TransportCatalogue& catalogue, const RouteSettings& settings)
+		{
+			const graph::DirectedWeightedGraph<double>& graph = catalogue.GetGraph();
+			if (settings.router_engine == RouterEngine::BIDIRECTIONAL_DIJKSTRA || settings.router_engine == RouterEngine::BIDIRECTIONAL_ASTAR)
+			{
+				return MakeBidirectionalRouter(catalogue, settings);
+			}
+			//Stored weights and everything precomputed from them are for the base's own settings,
+			//other ones are searched on the fly with the edges weighed anew
+			const RouteSettings& base_settings = catalogue.GetRouteSettings();
+			if (settings.bus_wait_time != base_settings.bus_wait_time || settings.bus_velocity != base_settings.bus_velocity)
+			{
+				return MakePrunedRouter(graph, settings, false, catalogue.GetEdgeWeigher(settings));
+			}
+			switch (settings.router_engine)
+			{
+			case RouterEngine::DIJKSTRA:
+				return MakePrunedRouter(graph, settings, false);
+			case RouterEngine::CONTRACTION_HIERARCHIES:
+				if (const auto& contraction_hierarchy = catalogue.GetContractionHierarchy())
+				{
+					return make_unique<graph::ContractionHierarchyRouter<double>>(contraction_hierarchy);
+				}
+				return make_unique<graph::ContractionHierarchyRouter<double>>(
+					make_shared<const graph::ContractionHierarchy<double>>(graph::BuildContractionHierarchy(graph)));
+			case RouterEngine::HUB_LABELS:
+				if (const auto& hub_labels = catalogue.GetHubLabels())
+				{
+					return make_unique<graph::HubLabelsRouter<double>>(graph, hub_labels);
+				}
+				return make_unique<graph::HubLabelsRouter<double>>(graph, make_shared<const graph::HubLabels<double>>(BuildHubLabels(graph)));
+			case RouterEngine::RAPTOR:
+				throw invalid_argument("Raptor engine doesn't route over the graph"s);
+			case RouterEngine::ALL_PAIRS:
+			default:
+				if (const auto& routes_table = catalogue.GetRoutesTable())
+				{
+					return make_unique<graph::Router<double>>(graph, *routes_table);
+				}
+				return MakePrunedRouter(graph, settings, true);
+			}
+		}
+
+		optional<vector<ReachableStop>> FindReachableStops(const TransportCatalogue& catalogue, const RouteSettings& settings, string_view from, double max_time)
+		{
+			const size_t stop_count = catalogue.GetStops().size();
+			const graph::VertexId from_vertex = catalogue.GetVertexId(from);
+			if (from_vertex >= stop_count)
+			{
+				return nullopt;
+			}
+			const graph::DirectedWeightedGraph<double>& graph = catalogue.GetGraph();
+			const RouteSettings& base_settings = catalogue.GetRouteSettings();
+			vector<pair<graph::VertexId, double>> reached;
+			if (settings.bus_wait_time != base_settings.bus_wait_time || settings.bus_velocity != base_settings.bus_velocity)
+			{
+				const EdgeWeigher edge_weigher = catalogue.GetEdgeWeigher(settings);
+				reached = graph::BuildIsochrone(graph, from_vertex, max_time, [&graph, &edge_weigher](graph::EdgeId edge_id, double)
+					{
+						return edge_weigher(graph.GetEdge(edge_id));
+					});
+			}
+			else
+			{
+				reached = graph::BuildIsochrone(graph, from_vertex, max_time);
+			}
+
+			//Ride vertices of the linear model aren't stops
+			vector<ReachableStop> result;
+			for (const auto& [vertex, time] : reached)
+			{
+				if (vertex < stop_count)
+				{
+					result.push_back({ catalogue.GetStopnameByIndex(vertex), time });
+				}
+			}
+			sort(result.begin(), result.end(), [](const ReachableStop& lhs, const ReachableStop& rhs)
+				{
+					return make_pair(lhs.time, lhs.stop_name) < make_pair(rhs.time, rhs.stop_name);
+				});
+			return result;
+		}
+
+		GraphModel ParseGraphModel(string_view model_name)
+		{
+			if (model_name == "pairwise"sv)
+			{
+				return GraphModel::PAIRWISE;
+			}
+			if (model_name == "linear"sv)
+			{
+				return GraphModel::LINEAR;
+			}
+			throw invalid_argument("Unknown graph model: "s + string(model_name));
+		}
+
+		StopOrder ParseStopOrder(string_view order_name)
+		{
+			if (order_name == "input"sv)
+			{
+				return StopOrder::INPUT;
+			}
+			if (order_name == "hilbert"sv)
+			{
+				return StopOrder::HILBERT;
+			}
+			throw invalid_argument("Unknown stop order: "s + string(order_name));
+		}
+
+		RouterWeights ParseRouterWeights(string_view weights_name)
+		{
+			if (weights_name == "double"sv)
+			{
+				return RouterWeights::DOUBLE;
+			}
+			if (weights_name == "float"sv)
+			{
+				return RouterWeights::FLOAT;
+			}
+			throw invalid_argument("Unknown router weights: "s + string(weights_name));
+		}
+
+		TransportRouter::TransportRouter(const TransportCatalogue& catalogue, const RouteSettings& settings)
+			: catalogue_(catalogue)
+			, settings_(settings)
+		{
+			const RouteSettings& base_settings = catalogue_.GetRouteSettings();
+			if (settings_.bus_wait_time != base_settings.bus_wait_time || settings_.bus_velocity != base_settings.bus_velocity)
+			{
+				edge_weigher_ = catalogue_.GetEdgeWeigher(settings_);
+			}
+			if (settings_.router_engine == RouterEngine::RAPTOR)
+			{
+				raptor_router_ = make_unique<RaptorRouter>(catalogue_, settings_);
+			}
+			else
+			{
+				router_ = MakeRouter(catalogue_, settings_);
+			}
+		}
+
+		optional<RouteResult> TransportRouter::BuildRoute(string_view from, string_view to) const
+		{
+			const graph::VertexId from_vertex = catalogue_.GetVertexId(from);
+			const graph::VertexId to_vertex = catalogue_.GetVertexId(to);
+			if (!IsStopVertex(from_vertex) || !IsStopVertex(to_vertex))
+			{
+				return nullopt;
+			}
+			if (raptor_router_)
+			{
+				return raptor_router_->BuildRoute(from_vertex, to_vertex);
+			}
+			optional<graph::RouterBase<double>::RouteInfo> route = router_->BuildRoute(from_vertex, to_vertex);
+			if (!route)
+			{
+				return nullopt;
+			}
+			return FoldEdges(route->weight, route->edges);
+		}
+
+		vector<optional<RouteResult>> TransportRouter::BuildRoutes(const vector<pair<string_view, string_view>>& queries, size_t thread_count) const
+		{
+			unordered_map<graph::VertexId, vector<size_t>> queries_by_source;
+			vector<graph::VertexId> sources;
+			for (size_t i = 0; i != queries.size(); ++i)
+			{
+				//Queries with an unknown stop are left without a route
+				const graph::VertexId from = catalogue_.GetVertexId(queries[i].first);
+				if (!IsStopVertex(from) || !IsStopVertex(catalogue_.GetVertexId(queries[i].second)))
+				{
+					continue;
+				}
+				vector<size_t>& source_queries = queries_by_source[from];
+				if (source_queries.empty())
+				{
+					sources.push_back(from);
+				}
+				source_queries.push_back(i);
+			}
+
+			vector<optional<RouteResult>> results(queries.size());
+			parallel::ForEachIndex(sources.size(), parallel::ResolveThreadCount(thread_count), [&](size_t source_index)
+				{
+					const graph::VertexId from = sources[source_index];
+					const vector<size_t>& source_queries = queries_by_source.at(from);
+					vector<graph::VertexId> targets;
+					targets.reserve(source_queries.size());
+					for (size_t query_index : source_queries)
+					{
+						targets.push_back(catalogue_.GetVertexId(queries[query_index].second));
+					}
+					if (raptor_router_)
+					{
+						vector<optional<RouteResult>> routes = raptor_router_->BuildRoutes(from, targets);
+						for (size_t i = 0; i != source_queries.size(); ++i)
+						{
+							results[source_queries[i]] = move(routes[i]);
+						}
+						return;
+					}
+					vector<optional<graph::RouterBase<double>::RouteInfo>> routes = router_->BuildRoutes(from, targets);
+					for (size_t i = 0; i != source_queries.size(); ++i)
+					{
+						if (routes[i])
+						{
+							results[source_queries[i]] = FoldEdges(routes[i]->weight, routes[i]->edges);
+						}
+					}
+				});
+			return results;
+		}
+
+		vector<optional<double>> TransportRouter::BuildTimeMatrix(const vector<string_view>& origins, const vector<string_view>& destinations, size_t thread_count) const
+		{
+			vector<graph::VertexId> targets;
+			targets.reserve(destinations.size());
+			for (string_view destination : destinations)
+			{
+				targets.push_back(catalogue_.GetVertexId(destination));
+			}
+
+			vector<optional<double>> times(origins.size() * destinations.size());
+			parallel::ForEachIndex(origins.size(), parallel::ResolveThreadCount(thread_count), [&](size_t origin_index)
+				{
+					const graph::VertexId from = catalogue_.GetVertexId(origins[origin_index]);
+					const auto row = times.begin() + origin_index * destinations.size();
+					if (raptor_router_)
+					{
+						const vector<optional<RouteResult>> routes = raptor_router_->BuildRoutes(from, targets);
+						transform(routes.begin(), routes.end(), row, [](const optional<RouteResult>& route)
+							{
+								return route ? optional<double>(route->total_time) : nullopt;
+							});
+						return;
+					}
+					const vector<optional<graph::RouterBase<double>::RouteInfo>> routes = router_->BuildRoutes(from, targets);
+					transform(routes.begin(), routes.end(), row, [](const optional<graph::RouterBase<double>::RouteInfo>& route)
+						{
+							return route ? optional<double>(route->weight) : nullopt;
+						});
+				});
+			return times;
+		}
+
+		const RouteSettings& TransportRouter::GetSettings() const
+		{
+			return settings_;
+		}
+
+		bool TransportRouter::IsStopVertex(graph::VertexId vertex) const
+		{
+			return vertex < catalogue_.GetStops().size();
+		}
+
+		double TransportRouter::GetEdgeTime(const graph::Edge<double>& edge) const
+		{
+			return edge_weigher_ ? (*edge_weigher_)(edge) : edge.weight;
+		}
+
+		RouteResult TransportRouter::FoldEdges(double total_time, const vector<graph::EdgeId>& edges) const
+		{
+			const graph::DirectedWeightedGraph<double>& graph = catalogue_.GetGraph();
+			const size_t stop_count = catalogue_.GetStops().size();
+			auto is_stop_vertex = [stop_count](graph::VertexId vertex) { return vertex < stop_count; };
+
+			RouteResult result{ total_time, {} };
+			for (graph::EdgeId edge_id : edges)
+			{
+				const graph::Edge<double>& edge = graph.GetEdge(edge_id);
+				if (is_stop_vertex(edge.from) && is_stop_vertex(edge.to))
+				{
+					result.items.push_back({ catalogue_.GetFirstStopByEdgeId(edge_id), catalogue_.GetBusName(edge.bus_id), static_cast<int>(edge.span_count), GetEdgeTime(edge) - settings_.bus_wait_time });
+				}
+				else if (is_stop_vertex(edge.from))
+				{
+					result.items.push_back({ catalogue_.GetFirstStopByEdgeId(edge_id), catalogue_.GetBusName(edge.bus_id), 0, 0.0 });
+				}
+				else if (result.items.empty())
+				{
+					throw logic_error("Route doesn't start at a stop vertex");
+				}
+				else if (!is_stop_vertex(edge.to))
+				{
+					result.items.back().span_count += edge.span_count;
+					result.items.back().time += GetEdgeTime(edge);
+				}
+				else if (result.items.back().span_count == 0)
+				{
+					// Boarded and got off at the same stop: only possible with zero wait time
+					result.items.pop_back();
+				}
+			}
+			return result;
+		}
+	}
+}
\ No newline at end of file
@@ -1,4 +1,113 @@
-/*
-Why do i exist? Everything works fine without me...
-Check 13th sprint(reviewed by Dmitry Mamontov). There were no trasport_router.h, transport_router.cpp used.
-*/
\ No newline at end of file
+#pragma once
+
+#include "domain.h"
+#include "graph.h"
+#include "raptor_router.h"
+#include "router_base.h"
+#include "transport_catalogue.h"
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue
+{
+	namespace transport_router
+	{
+		using RouterPtr = std::unique_ptr<graph::RouterBase<double>>;
+
+		// "all_pairs" - graph::Router, precomputes every pair on construction
+		//               (or restores the routes table persisted by make_base);
+		// "dijkstra"  - graph::DijkstraRouter, computes shortest-path trees on demand;
+		// "contraction_hierarchies" - graph::ContractionHierarchyRouter over the hierarchy
+		//               built by make_base (or built on the spot for older bases);
+		// "raptor"    - RaptorRouter, scans bus stop sequences round by round, no graph involved;
+		// "bidirectional_dijkstra" - graph::BidirectionalDijkstraRouter, searches every query
+		//               from both of its ends;
+		// "bidirectional_astar" - the same, directed by the great-circle distance between
+		//               stops covered at bus_velocity;
+		// "hub_labels" - graph::HubLabelsRouter over the labels built by make_base
+		//               (or built on the spot for older bases).
+		// Settings whose wait time or velocity differ from the base's get a DijkstraRouter
+		// over the reweighed edges, the bidirectional engines keep their own one.
+		// With router_memory_budget set, an all-pairs table that doesn't fit the budget isn't built:
+		// a DijkstraRouter takes over (reported to std::clog), memoizing as many trees as fit.
+		// Routers built at query time (all-pairs without a persisted table, Dijkstra) work over the graph
+		// compacted to its routable vertices by graph::PrunedRouter, which also answers the queries
+		// its strongly connected components rule out without searching.
+		// With router_weights "float" their tables hold float weights, the totals stay in double.
+		RouterEngine								ParseRouterEngine(std::string_view engine_name);
+		RouterPtr									MakeRouter(const TransportCatalogue& catalogue, const RouteSettings& settings);
+		bool										FitsMemoryBudget(size_t bytes, const RouteSettings& settings);
+		// Builds the labels and reports their size and build time to std::clog
+		graph::HubLabels<double>					BuildHubLabels(const graph::DirectedWeightedGraph<double>& graph);
+		GraphModel									ParseGraphModel(std::string_view model_name);
+		// "input" or "hilbert"
+		StopOrder									ParseStopOrder(std::string_view order_name);
+		// "double" or "float"
+		RouterWeights								ParseRouterWeights(std::string_view weights_name);
+
+		// One "Wait" + "Bus" pair of a route response
+		struct RouteItem
+		{
+			std::string_view						stop_name;
+			std::string_view						bus_name;
+			int										span_count;
+			double									time;
+		};
+
+		struct RouteResult
+		{
+			double									total_time;
+			std::vector<RouteItem>					items;
+		};
+
+		struct ReachableStop
+		{
+			std::string_view						stop_name;
+			double									time;
+		};
+
+		// Stops reachable from the stop within max_time minutes, the stop itself included,
+		// ordered by time and then by name; nullopt for an unknown stop.
+		// Only the part of the graph inside the time budget is searched.
+		std::optional<std::vector<ReachableStop>>	FindReachableStops(const TransportCatalogue& catalogue, const RouteSettings& settings,
+														std::string_view from, double max_time);
+
+		// Answers Route requests in terms of stops and buses, whatever graph model
+		// the base was built with and whichever engine searches the graph
+		class TransportRouter
+		{
+		public:
+			TransportRouter(const TransportCatalogue& catalogue, const RouteSettings& settings);
+
+			std::optional<RouteResult>				BuildRoute(std::string_view from, std::string_view to) const;
+			// Answers queries grouped by their source: one search per distinct source,
+			// different sources in parallel; the results follow the order of the queries
+			std::vector<std::optional<RouteResult>>	BuildRoutes(const std::vector<std::pair<std::string_view, std::string_view>>& queries, size_t thread_count) const;
+			// Travel times from every origin to every destination, row-major, nullopt where
+			// there is no route: one search per origin, the origins spread over the threads
+			std::vector<std::optional<double>>		BuildTimeMatrix(const std::vector<std::string_view>& origins, const std::vector<std::string_view>& destinations, size_t thread_count) const;
+			const RouteSettings&					GetSettings() const;
+
+		private:
+			// Pairwise edges map to one item each; boarding, riding and alighting edges
+			// of the linear model are folded into one item per ride
+			RouteResult								FoldEdges(double total_time, const std::vector<graph::EdgeId>& edges) const;
+			//Stop vertices come first, ids past them belong to rides of the linear model or to unknown stops
+			bool									IsStopVertex(graph::VertexId vertex) const;
+			//Minutes the edge takes: its stored weight, unless the settings reweigh the edges
+			double									GetEdgeTime(const graph::Edge<double>& edge) const;
+
+			const TransportCatalogue&				catalogue_;
+			RouteSettings							settings_;
+			//Set only if the wait time or velocity differ from the base's
+			std::optional<EdgeWeigher>				edge_weigher_;
+			//Exactly one of them is set, depending on the engine
+			RouterPtr								router_;
+			std::unique_ptr<RaptorRouter>			raptor_router_;
+		};
+	}
+}